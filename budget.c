@@ -0,0 +1,177 @@
+#ifndef BUDGET_C
+#define BUDGET_C
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "budget.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Returns the time of a monotonic clock, in seconds.
+ */
+static double budgetNow(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* ========= *
+ *  Object.  *
+ * ========= */
+
+/**
+ *  Starts a budget, clearing what has been used.
+ *
+ *  @param budget
+ *          The budget.
+ *  @param seconds
+ *          The wall time allowed, zero for no limit.
+ *  @param rows
+ *          The number of rows the solve may generate, zero for no limit.
+ *  @param bytes
+ *          The number of bytes the rows of one level may take, zero for no
+ *          limit.
+ */
+void budgetStart(zmk_budget_t* budget, double seconds, size_t rows,
+        size_t bytes)
+{
+    memset(budget, 0, sizeof *budget);
+    budget->seconds = seconds;
+    budget->maxRows = rows;
+    budget->maxBytes = bytes;
+    budget->start = budgetNow();
+}
+
+/**
+ *  Starts a budget with the limits set in the environment.
+ *
+ *  @param budget
+ *          The budget.
+ *  @return
+ *          Non-zero if the environment sets any limit.
+ */
+short budgetFromEnv(zmk_budget_t* budget)
+{
+    const char* env = getenv(BUDGET_ENV);
+    double seconds = 0;
+    size_t rows = 0;
+    size_t bytes = 0;
+
+    if (env == NULL || sscanf(env, "%lf:%zu:%zu", &seconds, &rows, &bytes) < 1)
+    {
+        return 0;
+    }
+    budgetStart(budget, seconds, rows, bytes);
+    return seconds > 0 || rows || bytes;
+}
+
+/**
+ *  Returns the number of seconds since the budget was started.
+ */
+double budgetElapsed(zmk_budget_t* budget)
+{
+    return budgetNow() - budget->start;
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Checks whether a solve has to stop, cheaply enough to be called for every
+ *  row or pair of rows. The cancel flags of the budget and its parents are
+ *  read on every call, the clock only once every {@code BUDGET_STRIDE}
+ *  calls.
+ *
+ *  @param budget
+ *          The budget, may be NULL for no limits.
+ *  @return
+ *          Non-zero if the solve has to stop.
+ */
+short budgetCheck(zmk_budget_t* budget)
+{
+    zmk_budget_t* b;
+
+    if (budget == NULL)
+    {
+        return 0;
+    }
+    for (b = budget; b != NULL; b = b->parent)
+    {
+        if (__atomic_load_n(&b->cancel, __ATOMIC_ACQUIRE))
+        {
+            return 1;
+        }
+    }
+    if (budget->seconds > 0 && budget->nChecks++ % BUDGET_STRIDE == 0
+            && budgetElapsed(budget) >= budget->seconds)
+    {
+        budgetCancel(budget);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ *  Cancels a budget, and with it every budget it is the parent of. Safe to
+ *  call from any thread, the solve stops at its next check.
+ *
+ *  @param budget
+ *          The budget.
+ */
+void budgetCancel(zmk_budget_t* budget)
+{
+    __atomic_store_n(&budget->cancel, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ *  Charges a budget for a new level of rows, called before it is allocated.
+ *
+ *  @param budget
+ *          The budget, may be NULL for no limits.
+ *  @param rows
+ *          The number of rows the level generates.
+ *  @param bytes
+ *          The number of bytes the level takes.
+ *  @return
+ *          Non-zero if the solve has to stop.
+ */
+short budgetLevel(zmk_budget_t* budget, size_t rows, size_t bytes)
+{
+    if (budget == NULL)
+    {
+        return 0;
+    }
+    budget->nRows = rows > (size_t) -1 - budget->nRows
+        ? (size_t) -1 : budget->nRows + rows;
+    budget->nBytes = bytes > budget->nBytes ? bytes : budget->nBytes;
+    if ((budget->maxRows && budget->nRows > budget->maxRows)
+            || (budget->maxBytes && bytes > budget->maxBytes))
+    {
+        budgetCancel(budget);
+    }
+    return budgetCheck(budget);
+}
+
+/**
+ *  Prints what a solve used of its budget on a single line.
+ *
+ *  @param budget
+ *          The budget.
+ */
+void printBudget(zmk_budget_t* budget)
+{
+    printf("budget: %zu rows generated, %zu bytes in the largest level, "
+        "%.3f s\n", budget->nRows, budget->nBytes, budgetElapsed(budget));
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <stddef.h>
+
+/*
+ *  The clock is read once every BUDGET_STRIDE checks, and the limits of a
+ *  budget may be set from the environment variable BUDGET_ENV as
+ *  "seconds[:rows[:bytes]]".
+ */
+#define BUDGET_STRIDE   (64)
+#define BUDGET_ENV      "ZMK_BUDGET"
+
+/**
+ *  Limits on a single solve and what it has used so far. A limit of zero
+ *  means no limit. A solver checks its budget as it generates rows and
+ *  stops with {@code ZMK_BUDGET} once a limit is passed or {@code cancel}
+ *  is set, which may be done from another thread through
+ *  {@code budgetCancel}. A budget also stops once any budget on its chain of
+ *  parents is cancelled.
+ */
+typedef struct zmk_budget {
+    double seconds;         /* Wall time allowed. */
+    size_t maxRows;         /* Rows generated allowed. */
+    size_t maxBytes;        /* Bytes allowed for the rows of one level. */
+    volatile int cancel;    /* Non-zero to stop the solve. */
+    size_t nRows;           /* Rows generated so far. */
+    size_t nBytes;          /* Largest level so far, in bytes. */
+    size_t nChecks;         /* Checks so far. */
+    double start;           /* When the budget was started. */
+    struct zmk_budget* parent;  /* Whose cancellation also stops this one. */
+} zmk_budget_t;
+
+void budgetStart(zmk_budget_t*, double, size_t, size_t);
+short budgetFromEnv(zmk_budget_t*);
+double budgetElapsed(zmk_budget_t*);
+short budgetLevel(zmk_budget_t*, size_t, size_t);
+short budgetCheck(zmk_budget_t*);
+void budgetCancel(zmk_budget_t*);
+void printBudget(zmk_budget_t*);
+
+#endif
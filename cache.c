@@ -0,0 +1,500 @@
+#ifndef CACHE_C
+#define CACHE_C
+
+#include "cache.h"
+#include "coeff.h"
+#include "util.h"
+#include "zmk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_MAGIC     (0x5a4d4b43u)   /* "ZMKC" */
+#define CACHE_VERSION   (1u)
+#define CACHE_NIL       ((size_t) -1)
+
+/*
+ *  The cache is a hash table of at most {@code size} entries, chained through
+ *  {@code chain}, which are also kept on a list from the most recently used
+ *  at {@code head} to the least recently used at {@code tail}. Entries are
+ *  never freed one by one, once the cache is full the tail is reused.
+ */
+typedef struct cache_entry {
+    cache_key_t key;
+    INT_T result;
+    size_t prev;
+    size_t next;
+    size_t chain;
+} cache_entry_t;
+
+struct cache {
+    cache_entry_t* entries;
+    size_t* buckets;
+    size_t size;
+    size_t used;
+    size_t head;
+    size_t tail;
+};
+
+/*
+ *  A row of a system in canonical form as handed to qsort.
+ */
+typedef struct cache_row {
+    long long* v;
+    INT_T W;
+} cache_row_t;
+
+/*
+ *  A column and its signature as handed to qsort.
+ */
+typedef struct cache_col {
+    unsigned long long sig;
+    INT_T var;
+} cache_col_t;
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Scrambles the bits of a word, the finalizer of splitmix64.
+ */
+static unsigned long long cacheMix(unsigned long long x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ *  Adds a value to both halves of a key, which are mixed independently.
+ */
+static void cacheHash(cache_key_t* key, long long v)
+{
+    key->hi = cacheMix(key->hi ^ ((unsigned long long) v
+        + 0x9e3779b97f4a7c15ull));
+    key->lo = cacheMix(key->lo + ((unsigned long long) v
+        ^ 0xc2b2ae3d27d4eb4full));
+}
+
+/**
+ *  Orders rows lexicographically over their coefficients and constant.
+ */
+static int compareCacheRows(const void* ap, const void* bp)
+{
+    const cache_row_t* a = ap;
+    const cache_row_t* b = bp;
+    INT_T j;
+
+    for (j = 0; j < a->W; ++j)
+    {
+        if (a->v[j] < b->v[j])
+            return -1;
+        else if (a->v[j] > b->v[j])
+            return +1;
+    }
+    return 0;
+}
+
+/**
+ *  Orders columns by their signature, columns that can not be told apart
+ *  keep their order.
+ */
+static int compareCacheCols(const void* ap, const void* bp)
+{
+    const cache_col_t* a = ap;
+    const cache_col_t* b = bp;
+
+    if (a->sig != b->sig)
+        return a->sig < b->sig ? -1 : +1;
+    else
+        return a->var - b->var;
+}
+
+/**
+ *  Returns the bucket of a key.
+ */
+static size_t cacheBucket(const cache_t* cache, const cache_key_t* key)
+{
+    return (size_t) (key->lo % cache->size);
+}
+
+/**
+ *  Unlinks an entry from the recency list.
+ */
+static void cacheUnlink(cache_t* cache, size_t i)
+{
+    cache_entry_t* e = cache->entries + i;
+
+    if (e->prev != CACHE_NIL)
+        cache->entries[e->prev].next = e->next;
+    else
+        cache->head = e->next;
+    if (e->next != CACHE_NIL)
+        cache->entries[e->next].prev = e->prev;
+    else
+        cache->tail = e->prev;
+}
+
+/**
+ *  Links an entry at the front of the recency list.
+ */
+static void cachePush(cache_t* cache, size_t i)
+{
+    cache_entry_t* e = cache->entries + i;
+
+    e->prev = CACHE_NIL;
+    e->next = cache->head;
+    if (cache->head != CACHE_NIL)
+        cache->entries[cache->head].prev = i;
+    cache->head = i;
+    if (cache->tail == CACHE_NIL)
+        cache->tail = i;
+}
+
+/**
+ *  Removes an entry from the chain of its bucket.
+ */
+static void cacheUnchain(cache_t* cache, size_t i)
+{
+    size_t* link = cache->buckets + cacheBucket(cache, &cache->entries[i].key);
+
+    while (*link != i)
+    {
+        link = &cache->entries[*link].chain;
+    }
+    *link = cache->entries[i].chain;
+}
+
+/* ========= *
+ *  Object.  *
+ * ========= */
+
+/**
+ *  Allocates memory for an empty cache.
+ *
+ *  @param size
+ *          The number of results kept.
+ *  @return
+ *          A pointer to the cache, NULL if memory ran out.
+ */
+cache_t* newCache(size_t size)
+{
+    cache_t* cache = (cache_t*) malloc(sizeof(cache_t));
+    size_t i;
+
+    if (cache == NULL)
+    {
+        return NULL;
+    }
+    cache->size = size ? size : 1;
+    cache->entries = (cache_entry_t*) malloc(sizeof(cache_entry_t)
+        * cache->size);
+    cache->buckets = (size_t*) malloc(sizeof(size_t) * cache->size);
+    if (cache->entries == NULL || cache->buckets == NULL)
+    {
+        freeCache(cache);
+        return NULL;
+    }
+    for (i = 0; i < cache->size; ++i)
+    {
+        cache->buckets[i] = CACHE_NIL;
+    }
+    cache->used = 0;
+    cache->head = cache->tail = CACHE_NIL;
+    return cache;
+}
+
+/**
+ *  Frees the memory of a cache.
+ *
+ *  @param cache
+ *          The cache to free, may be NULL.
+ */
+void freeCache(cache_t* cache)
+{
+    if (cache == NULL)
+    {
+        return;
+    }
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Hashes a system in a form that does not depend on the order of its rows
+ *  or columns.
+ *  <p>
+ *  Each row is scaled to integers by {@code integerEquation} and divided by
+ *  the gcd of all its entries. Columns are then sorted by a signature that
+ *  sums, over their non-zero entries, the value combined with a signature of
+ *  its row that does not depend on the column order. The permuted rows are
+ *  sorted, duplicates are skipped and what is left is hashed with the size
+ *  of the system. Systems whose columns can not be told apart by their
+ *  signatures may get different keys for different orders, which only costs
+ *  a miss. The system itself is left untouched.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param key
+ *          Set to the key of the system.
+ *  @return
+ *          Zero if the system could not be scaled to integers, non-zero
+ *          otherwise.
+ */
+short cacheKey(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, cache_key_t* key)
+{
+    INT_T W = nVar + 1;
+    size_t n = nEqn;
+    long long* scaled = (long long*) malloc(sizeof(long long) * W * (n + 1));
+    long long* permuted = (long long*) malloc(sizeof(long long) * W * (n + 1));
+    unsigned long long* rowSig = (unsigned long long*)
+        malloc(sizeof(unsigned long long) * (n + 1));
+    cache_col_t* cols = (cache_col_t*) malloc(sizeof(cache_col_t) * W);
+    cache_row_t* rows = (cache_row_t*) malloc(sizeof(cache_row_t) * (n + 1));
+    long long* row;
+    long long g;
+    size_t nUnique = 0;
+    size_t i;
+    short ok = 1;
+    INT_T j;
+
+    if (scaled == NULL || permuted == NULL || rowSig == NULL || cols == NULL
+            || rows == NULL)
+    {
+        ok = 0;
+    }
+
+    for (i = 0; ok && i < n; ++i)
+    {
+        row = scaled + i * W;
+        if (!integerEquation(eqns[i], nVar, row))
+        {
+            ok = 0;
+            break;
+        }
+        for (j = 0, g = 0; j < W; ++j)
+        {
+            g = gcdLong(g, row[j]);
+        }
+        rowSig[i] = 0;
+        for (j = 0; j < W; ++j)
+        {
+            row[j] /= g > 1 ? g : 1;
+            rowSig[i] += cacheMix((unsigned long long) row[j]
+                + (j == nVar ? 0x9e3779b97f4a7c15ull : 0));
+        }
+    }
+
+    if (ok)
+    {
+        for (j = 0; j < nVar; ++j)
+        {
+            cols[j].var = j;
+            cols[j].sig = 0;
+            for (i = 0; i < n; ++i)
+            {
+                if (scaled[i * W + j])
+                {
+                    cols[j].sig += cacheMix(rowSig[i]
+                        ^ (unsigned long long) scaled[i * W + j]);
+                }
+            }
+        }
+        qsort(cols, nVar, sizeof cols[0], compareCacheCols);
+
+        for (i = 0; i < n; ++i)
+        {
+            for (j = 0; j < nVar; ++j)
+            {
+                permuted[i * W + j] = scaled[i * W + cols[j].var];
+            }
+            permuted[i * W + nVar] = scaled[i * W + nVar];
+            rows[i].v = permuted + i * W;
+            rows[i].W = W;
+        }
+        qsort(rows, n, sizeof rows[0], compareCacheRows);
+
+        key->hi = key->lo = 0;
+        for (i = 0; i < n; ++i)
+        {
+            if (i && !compareCacheRows(rows + i - 1, rows + i))
+            {
+                continue;
+            }
+            for (j = 0; j < W; ++j)
+            {
+                cacheHash(key, rows[i].v[j]);
+            }
+            ++nUnique;
+        }
+        cacheHash(key, nVar);
+        cacheHash(key, (long long) nUnique);
+    }
+
+    free(scaled);
+    free(permuted);
+    free(rowSig);
+    free(cols);
+    free(rows);
+    return ok;
+}
+
+/**
+ *  Looks a system up, making it the most recently used one if found.
+ *
+ *  @param cache
+ *          The cache.
+ *  @param key
+ *          The key of the system.
+ *  @return
+ *          {@code ZMK_SAT} or {@code ZMK_UNSAT} if the system is cached,
+ *          {@code ZMK_UNKNOWN} otherwise.
+ */
+INT_T cacheLookup(cache_t* cache, const cache_key_t* key)
+{
+    size_t i = cache->buckets[cacheBucket(cache, key)];
+
+    while (i != CACHE_NIL)
+    {
+        if (cache->entries[i].key.hi == key->hi
+                && cache->entries[i].key.lo == key->lo)
+        {
+            cacheUnlink(cache, i);
+            cachePush(cache, i);
+            return cache->entries[i].result;
+        }
+        i = cache->entries[i].chain;
+    }
+    return ZMK_UNKNOWN;
+}
+
+/**
+ *  Stores the result of a system, evicting the least recently used one if
+ *  the cache is full.
+ *
+ *  @param cache
+ *          The cache.
+ *  @param key
+ *          The key of the system.
+ *  @param result
+ *          {@code ZMK_SAT} or {@code ZMK_UNSAT}, anything else is not
+ *          stored.
+ */
+void cacheInsert(cache_t* cache, const cache_key_t* key, INT_T result)
+{
+    size_t b = cacheBucket(cache, key);
+    size_t i;
+
+    if (result != ZMK_SAT && result != ZMK_UNSAT)
+    {
+        return;
+    }
+    if (cacheLookup(cache, key) != ZMK_UNKNOWN)
+    {
+        cache->entries[cache->head].result = result;
+        return;
+    }
+
+    if (cache->used < cache->size)
+    {
+        i = cache->used++;
+    } else {
+        i = cache->tail;
+        cacheUnchain(cache, i);
+        cacheUnlink(cache, i);
+    }
+
+    cache->entries[i].key = *key;
+    cache->entries[i].result = result;
+    cache->entries[i].chain = cache->buckets[b];
+    cache->buckets[b] = i;
+    cachePush(cache, i);
+}
+
+/**
+ *  Adds the results saved by {@code saveCache} to a cache. A missing file is
+ *  not an error.
+ *
+ *  @param cache
+ *          The cache.
+ *  @param path
+ *          The file to read.
+ *  @return
+ *          Zero if the file exists but could not be read, non-zero otherwise.
+ */
+short loadCache(cache_t* cache, const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    unsigned int header[2];
+    cache_key_t key;
+    signed char result;
+
+    if (file == NULL)
+    {
+        return 1;
+    }
+    if (fread(header, sizeof header, 1, file) != 1
+            || header[0] != CACHE_MAGIC || header[1] != CACHE_VERSION)
+    {
+        fclose(file);
+        return 0;
+    }
+    while (fread(&key, sizeof key, 1, file) == 1
+            && fread(&result, sizeof result, 1, file) == 1)
+    {
+        if (result == ZMK_SAT || result == ZMK_UNSAT)
+        {
+            cacheInsert(cache, &key, result);
+        }
+    }
+    fclose(file);
+    return 1;
+}
+
+/**
+ *  Writes the results of a cache to a file, least recently used first so that
+ *  {@code loadCache} restores their order.
+ *
+ *  @param cache
+ *          The cache.
+ *  @param path
+ *          The file to write.
+ *  @return
+ *          Zero if the file could not be written, non-zero otherwise.
+ */
+short saveCache(cache_t* cache, const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    unsigned int header[2] = { CACHE_MAGIC, CACHE_VERSION };
+    signed char result;
+    short ok;
+    size_t i;
+
+    if (file == NULL)
+    {
+        return 0;
+    }
+    ok = fwrite(header, sizeof header, 1, file) == 1;
+    for (i = cache->tail; ok && i != CACHE_NIL; i = cache->entries[i].prev)
+    {
+        result = (signed char) cache->entries[i].result;
+        ok = fwrite(&cache->entries[i].key, sizeof(cache_key_t), 1, file) == 1
+            && fwrite(&result, sizeof result, 1, file) == 1;
+    }
+    return fclose(file) == 0 && ok;
+}
+
+#endif
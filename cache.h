@@ -0,0 +1,32 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "coeff.h"
+#include <stddef.h>
+
+/*
+ *  Number of results kept by the cache used by zmk_fm_cached, and the
+ *  environment variable naming the file they are kept in between runs.
+ */
+#define CACHE_SIZE  (4096)
+#define CACHE_ENV   "ZMK_CACHE_FILE"
+
+/**
+ *  A 128-bit hash of a system in canonical form.
+ */
+typedef struct cache_key {
+    unsigned long long hi;
+    unsigned long long lo;
+} cache_key_t;
+
+typedef struct cache cache_t;
+
+cache_t* newCache(size_t);
+void freeCache(cache_t*);
+short cacheKey(EQN_T***, ROW_T, INT_T, cache_key_t*);
+INT_T cacheLookup(cache_t*, const cache_key_t*);
+void cacheInsert(cache_t*, const cache_key_t*, INT_T);
+short loadCache(cache_t*, const char*);
+short saveCache(cache_t*, const char*);
+
+#endif
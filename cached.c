@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ *  My includes and defines.
+ */
+#include "cache.h"
+#include "coeff.h"
+#include "engine.h"
+#include "util.h"
+#include "zmk.h"
+
+static unsigned long long   fm_count;
+static cache_t*             cache;
+
+static void save(void)
+{
+    if (!saveCache(cache, getenv(CACHE_ENV)))
+        fprintf(stderr, "could not save cache to %s\n", getenv(CACHE_ENV));
+}
+
+/*
+ *  Decides a system through the cache, solving and storing it on a miss.
+ */
+static INT_T solve(FILE* afile, FILE* cfile)
+{
+    ROW_T nEqn = 0;
+    INT_T nVar = 0;
+    EQN_T*** eqns = parseSystem(afile, cfile, &nEqn, &nVar);
+    cache_key_t key;
+    INT_T res;
+
+    if (eqns == NULL) {
+        fprintf(stderr, "values in A or c do not fit a coefficient\n");
+        exit(1);
+    }
+    if (!cacheKey(eqns, nEqn, nVar, &key))
+        return zmkSolve(eqns, nEqn, nVar, NULL, NULL);
+
+    res = cacheLookup(cache, &key);
+    if (res != ZMK_UNKNOWN) {
+        freeSystem(eqns, nEqn, nVar + 1);
+        return res;
+    }
+
+    res = zmkSolve(eqns, nEqn, nVar, NULL, NULL);
+    cacheInsert(cache, &key, res);
+    return res;
+}
+
+unsigned long long zmk_fm_cached(char* aname, char* cname, int seconds)
+{
+    FILE*       afile = fopen(aname, "r");
+    FILE*       cfile = fopen(cname, "r");
+
+    fm_count = 0;
+
+    if (afile == NULL) {
+        fprintf(stderr, "could not open file A\n");
+        exit(1);
+    }
+
+    if (cfile == NULL) {
+        fprintf(stderr, "could not open file c\n");
+        exit(1);
+    }
+
+    /*
+     *  The cache lives as long as the program, and in the file named by
+     *  ZMK_CACHE_FILE if there is one.
+     */
+    if (cache == NULL) {
+        cache = newCache(CACHE_SIZE);
+        if (cache == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        if (getenv(CACHE_ENV) != NULL) {
+            if (!loadCache(cache, getenv(CACHE_ENV)))
+                fprintf(stderr, "ignoring cache file %s\n",
+                    getenv(CACHE_ENV));
+            atexit(save);
+        }
+    }
+
+    if (seconds == 0) {
+        /* Just run once for validation. */
+        INT_T res = solve(afile, cfile);
+
+        fclose(afile);
+        fclose(cfile);
+        return engineAnswer(res);
+    }
+
+    /*
+     *  Now loop until the time is up...
+     */
+    zmk_budget_t run;
+    budgetStart(&run, seconds, 0, 0);
+    while (budgetElapsed(&run) < seconds) {
+        rewind(afile);
+        rewind(cfile);
+        solve(afile, cfile);
+        fm_count++;
+    }
+    fclose(afile);
+    fclose(cfile);
+    return fm_count;
+}
+
+ZMK_ENGINE(zmk_fm_cached, ENGINE_EXACT | ENGINE_CACHE)
@@ -5,6 +5,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/*
+ *  Set on the calling thread once a result did not fit a coefficient, read
+ *  and cleared by coeffOverflowed.
+ */
+static __thread short overflow;
+
 /* ========= *
  *  Object.  *
  * ========= */
@@ -77,8 +83,113 @@ EQN_T* copyCoeff(EQN_T* coeff)
  *  Arithmetic.  *
  * ============= */
 
+/**
+ *  Computes the greatest common divisor of two integers.
+ *
+ *  @param a
+ *          The first integer.
+ *  @param b
+ *          The second integer.
+ *  @return
+ *          The non-negative greatest common divisor, zero if both are zero.
+ */
+INT_T gcdInt(INT_T a, INT_T b)
+{
+    INT_T t;
+    a = a < 0 ? -a : a;
+    b = b < 0 ? -b : b;
+    while (b)
+    {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/**
+ *  Computes the greatest common divisor of two wide integers.
+ *
+ *  @param a
+ *          The first integer.
+ *  @param b
+ *          The second integer.
+ *  @return
+ *          The non-negative greatest common divisor, zero if both are zero.
+ */
+long long gcdLong(long long a, long long b)
+{
+    long long t;
+    a = a < 0 ? -a : a;
+    b = b < 0 ? -b : b;
+    while (b)
+    {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/**
+ *  Stores a fraction in a coefficient in lowest terms. The products made by
+ *  the arithmetic below are formed in a {@code long} and only have to fit the
+ *  coefficient once they have been reduced.
+ *
+ *  @param coeff
+ *          The coefficient to set.
+ *  @param nom
+ *          The nominator.
+ *  @param denom
+ *          The non-zero denominator.
+ */
+static void setCoeff(EQN_T* coeff, long nom, long denom)
+{
+    long a = nom < 0 ? -nom : nom;
+    long b = denom < 0 ? -denom : denom;
+    long t;
+    while (b)
+    {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    if (a > 1)
+    {
+        nom /= a;
+        denom /= a;
+    }
+    if ((INT_T) nom != nom || (INT_T) denom != denom)
+    {
+        overflow = 1;
+    }
+    coeff->nom = (INT_T) nom;
+    coeff->denom = (INT_T) denom;
+    fixSign(coeff);
+}
+
+/**
+ *  Reduces a coefficient to lowest terms, keeping the sign on the nominator.
+ *
+ *  @param coeff
+ *          The coefficient to reduce.
+ */
+void reduceCoeff(EQN_T* coeff)
+{
+    INT_T g = gcdInt(coeff->nom, coeff->denom);
+    if (g > 1)
+    {
+        coeff->nom /= g;
+        coeff->denom /= g;
+    }
+    fixSign(coeff);
+}
+
 /**
  *  Returns whether or not a coefficient is less than another.
+ *  <p>
+ *  The comparison is exact, both denominators are kept positive by
+ *  {@code fixSign} so the coefficients can be cross-multiplied.
  *
  *  @param lhs
  *          The left coefficient.
@@ -89,7 +200,7 @@ EQN_T* copyCoeff(EQN_T* coeff)
  */
 short lessThanCoeff(EQN_T* lhs, EQN_T* rhs)
 {
-    return evalCoeff(lhs) < evalCoeff(rhs);
+    return (long) lhs->nom * rhs->denom < (long) rhs->nom * lhs->denom;
 }
 
 /**
@@ -127,15 +238,21 @@ void addCoeff(EQN_T lhs, EQN_T rhs)
 EQN_T* subCoeff(EQN_T lhs, EQN_T rhs)
 {
     EQN_T* coeff = newCoeff(0, 0);
+    long nom;
     if (lhs.denom == rhs.denom)
     {
-        coeff->nom = lhs.nom - rhs.nom;
+        nom = (long) lhs.nom - rhs.nom;
+        if ((INT_T) nom != nom)
+        {
+            overflow = 1;
+        }
+        coeff->nom = (INT_T) nom;
         coeff->denom = lhs.denom;
+        reduceCoeff(coeff);
     } else {
-        coeff->nom = (lhs.nom * rhs.denom - rhs.nom * lhs.denom);
-        coeff->denom = lhs.denom * rhs.denom;
+        setCoeff(coeff, (long) lhs.nom * rhs.denom - (long) rhs.nom * lhs.denom,
+            (long) lhs.denom * rhs.denom);
     }
-    fixSign(coeff);
     return coeff;
 }
 
@@ -154,11 +271,26 @@ void divCoeff(EQN_T* lhs, EQN_T* rhs)
     if (lhs->denom == rhs->denom)
     {
         lhs->denom = rhs->nom;
+        reduceCoeff(lhs);
     } else {
-        lhs->nom *= rhs->denom;
-        lhs->denom *= rhs->nom;
+        setCoeff(lhs, (long) lhs->nom * rhs->denom,
+            (long) lhs->denom * rhs->nom);
     }
-    fixSign(lhs);
+}
+
+/**
+ *  Tells whether a result of {@code subCoeff} or {@code divCoeff} on the
+ *  calling thread did not fit a coefficient since the last call, and
+ *  clears that.
+ *
+ *  @return
+ *          Non-zero if a coefficient overflowed.
+ */
+short coeffOverflowed(void)
+{
+    short res = overflow;
+    overflow = 0;
+    return res;
 }
 
 /**
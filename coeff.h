@@ -1,8 +1,22 @@
 #ifndef COEFF_H
 #define COEFF_H
 
+#include <stddef.h>
+
+/*
+ *  Coefficients are fractions of two COEFF_T, short unless the build asks
+ *  for another width with -DCOEFF_T=int or the like. INT_T is the same type
+ *  and also counts variables and carries results. Rows are counted and
+ *  indexed with ROW_T, which is as wide as the memory they could fill, so
+ *  that the width of the coefficients does not limit the size of a level.
+ */
+#ifndef COEFF_T
+#define COEFF_T short
+#endif
+
 #define EQN_T coeff_t
-#define INT_T short
+#define INT_T COEFF_T
+#define ROW_T size_t
 
 typedef struct coeff {
     INT_T nom;
@@ -12,11 +26,15 @@ typedef struct coeff {
 void fixSign(EQN_T* coeff);
 EQN_T* copyCoeff(EQN_T*);
 EQN_T* newCoeff(INT_T, INT_T);
+INT_T gcdInt(INT_T, INT_T);
+long long gcdLong(long long, long long);
+void reduceCoeff(EQN_T*);
 
 short lessThanCoeff(EQN_T*, EQN_T*);
 void addCoeff(EQN_T, EQN_T);
 EQN_T* subCoeff(EQN_T, EQN_T);
 void divCoeff(EQN_T*, EQN_T*);
 float evalCoeff(EQN_T*);
+short coeffOverflowed(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,353 @@
+#ifndef COMPONENT_C
+#define COMPONENT_C
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "coeff.h"
+#include "util.h"
+#include "zmk.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ *  A system whose variables fall into groups that never share a row is
+ *  solved one group at a time. Each component_t holds such a group with its
+ *  columns renumbered from zero, and its own budget so that it can be
+ *  cancelled on its own.
+ */
+typedef struct component {
+    EQN_T*** eqns;
+    ROW_T nEqn;
+    INT_T nVar;
+    INT_T res;
+    zmk_budget_t budget;
+} component_t;
+
+/*
+ *  What the threads solving the components of one system share.
+ */
+typedef struct component_pool {
+    component_t* parts;
+    INT_T nParts;
+    INT_T next;             /* The next component to solve. */
+    int unsat;              /* Non-zero once a component has no solution. */
+    pthread_mutex_t lock;
+} component_pool_t;
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Returns the representative of a variable, halving the path to it.
+ */
+static INT_T componentFind(INT_T* parent, INT_T v)
+{
+    while (parent[v] != v)
+    {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+    }
+    return v;
+}
+
+/**
+ *  Splits a system into its connected components, where two variables are
+ *  connected if some row uses both. Rows without variables go with the
+ *  first component.
+ *  <p>
+ *  The coefficients are moved to the rows of the components, the rest of
+ *  the system is freed.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param parts
+ *          Set to the components if there are at least two.
+ *  @return
+ *          The number of components, 1 if there is only one or memory ran
+ *          out, in which case the system is left untouched.
+ */
+static INT_T componentSplit(EQN_T*** eqns, ROW_T nEqn, INT_T nVar,
+        component_t** parts)
+{
+    INT_T* parent = (INT_T*) malloc(sizeof(INT_T) * 3 * (nVar + 1));
+    INT_T* index = parent + nVar + 1;
+    INT_T* part = index + nVar + 1;
+    component_t* p;
+    EQN_T** eqn;
+    INT_T first;
+    INT_T nParts = 0;
+    INT_T j;
+    INT_T k;
+    ROW_T i;
+
+    if (parent == NULL)
+    {
+        return 1;
+    }
+    for (j = 0; j < nVar; ++j)
+    {
+        parent[j] = j;
+    }
+
+    /* Every row joins the variables it uses. */
+    for (i = 0; i < nEqn; ++i)
+    {
+        first = -1;
+        for (j = 0; j < nVar; ++j)
+        {
+            if (!eqns[i][j]->nom)
+            {
+                continue;
+            }
+            if (first < 0)
+            {
+                first = componentFind(parent, j);
+            } else {
+                k = componentFind(parent, j);
+                parent[k] = first;
+            }
+        }
+    }
+
+    /* Number the components and the columns within them. */
+    for (j = 0; j < nVar; ++j)
+    {
+        part[j] = -1;
+    }
+    for (j = 0; j < nVar; ++j)
+    {
+        k = componentFind(parent, j);
+        if (part[k] < 0)
+        {
+            part[k] = nParts++;
+        }
+        part[j] = part[k];
+    }
+    if (nParts < 2)
+    {
+        free(parent);
+        return 1;
+    }
+
+    *parts = (component_t*) calloc(nParts, sizeof(component_t));
+    if (*parts == NULL)
+    {
+        free(parent);
+        return 1;
+    }
+    for (j = 0; j < nVar; ++j)
+    {
+        index[j] = (*parts)[part[j]].nVar++;
+    }
+    for (i = 0; i < nEqn; ++i)
+    {
+        for (j = 0; j < nVar && !eqns[i][j]->nom; ++j)
+            ;
+        (*parts)[j < nVar ? part[j] : 0].nEqn++;
+    }
+    for (k = 0; k < nParts; ++k)
+    {
+        p = *parts + k;
+        p->eqns = (EQN_T***) malloc(sizeof(EQN_T**) * (p->nEqn + 1));
+        p->nEqn = 0;
+    }
+
+    for (i = 0; i < nEqn; ++i)
+    {
+        for (j = 0; j < nVar && !eqns[i][j]->nom; ++j)
+            ;
+        p = *parts + (j < nVar ? part[j] : 0);
+        eqn = (EQN_T**) malloc(sizeof(EQN_T*) * (p->nVar + 1));
+        for (j = 0; j < nVar; ++j)
+        {
+            if (p == *parts + part[j])
+                eqn[index[j]] = eqns[i][j];
+            else
+                free(eqns[i][j]);
+        }
+        eqn[p->nVar] = eqns[i][nVar];
+        free(eqns[i]);
+        p->eqns[p->nEqn++] = eqn;
+    }
+    free(eqns);
+    free(parent);
+    return nParts;
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Solves components until none is left or one has no solution, which
+ *  cancels the others.
+ */
+static void* componentWork(void* arg)
+{
+    component_pool_t* pool = (component_pool_t*) arg;
+    component_t* p;
+    INT_T k;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        k = pool->unsat ? pool->nParts : pool->next;
+        pool->next += k < pool->nParts;
+        pthread_mutex_unlock(&pool->lock);
+        if (k == pool->nParts)
+        {
+            break;
+        }
+
+        p = pool->parts + k;
+        p->res = zmkEliminate(p->eqns, p->nEqn, p->nVar, &p->budget);
+        p->eqns = NULL;
+        if (p->res == ZMK_UNSAT)
+        {
+            pthread_mutex_lock(&pool->lock);
+            pool->unsat = 1;
+            for (k = 0; k < pool->nParts; ++k)
+            {
+                budgetCancel(&pool->parts[k].budget);
+            }
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+    return NULL;
+}
+
+/**
+ *  Decides a presolved system by splitting it into components over
+ *  disjoint sets of variables and solving each with {@code zmkEliminate},
+ *  which costs the sum of their eliminations instead of their product.
+ *  <p>
+ *  The components are solved in order, or by as many threads as the
+ *  environment variable {@code THREADS_ENV} asks for, and the first one
+ *  without a solution ends the solve. Threads give each component its own
+ *  copy of the budget, a child of the one passed in so that cancelling it
+ *  still stops them, whose counters are added up afterwards. The system is
+ *  freed in all cases.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param budget
+ *          The budget of the solve, may be NULL.
+ *  @return
+ *          {@code ZMK_SAT} or {@code ZMK_UNSAT}, or {@code ZMK_BUDGET} if
+ *          the budget ran out before a component without a solution was
+ *          found, and otherwise {@code ZMK_UNKNOWN} if a component could
+ *          not be decided.
+ */
+INT_T zmkComponents(EQN_T*** eqns, ROW_T nEqn, INT_T nVar,
+        zmk_budget_t* budget)
+{
+    component_pool_t pool;
+    component_t* parts = NULL;
+    pthread_t* threads = NULL;
+    const char* env = getenv(THREADS_ENV);
+    INT_T nParts = componentSplit(eqns, nEqn, nVar, &parts);
+    INT_T res = ZMK_SAT;
+    int nThreads = env != NULL ? atoi(env) : 1;
+    int nStarted = 0;
+    size_t rows = 0;
+    INT_T k;
+
+    if (nParts < 2)
+    {
+        return zmkEliminate(eqns, nEqn, nVar, budget);
+    }
+
+    nThreads = nThreads < nParts ? nThreads : nParts;
+    if (nThreads > 1)
+    {
+        threads = (pthread_t*) malloc(sizeof(pthread_t) * nThreads);
+    }
+
+    if (threads == NULL)
+    {
+        for (k = 0; k < nParts && res != ZMK_UNSAT && res != ZMK_BUDGET;
+                ++k)
+        {
+            parts[k].res = zmkEliminate(parts[k].eqns, parts[k].nEqn,
+                parts[k].nVar, budget);
+            parts[k].eqns = NULL;
+            if (parts[k].res <= 0 && (parts[k].res != ZMK_UNKNOWN
+                    || res == ZMK_SAT))
+            {
+                res = parts[k].res;
+            }
+        }
+    } else {
+        for (k = 0; k < nParts; ++k)
+        {
+            if (budget != NULL)
+                parts[k].budget = *budget;
+            else
+                budgetStart(&parts[k].budget, 0, 0, 0);
+            parts[k].budget.parent = budget;
+        }
+        pool.parts = parts;
+        pool.nParts = nParts;
+        pool.next = 0;
+        pool.unsat = 0;
+        pthread_mutex_init(&pool.lock, NULL);
+        while (nStarted < nThreads - 1 && !pthread_create(threads + nStarted,
+                NULL, componentWork, &pool))
+        {
+            ++nStarted;
+        }
+        componentWork(&pool);
+        for (k = 0; k < nStarted; ++k)
+        {
+            pthread_join(threads[k], NULL);
+        }
+        pthread_mutex_destroy(&pool.lock);
+
+        res = pool.unsat ? ZMK_UNSAT : ZMK_SAT;
+        for (k = 0; k < nParts; ++k)
+        {
+            if (!pool.unsat && parts[k].res == ZMK_BUDGET)
+            {
+                res = ZMK_BUDGET;
+            } else if (!pool.unsat && parts[k].res == ZMK_UNKNOWN
+                    && res == ZMK_SAT) {
+                res = ZMK_UNKNOWN;
+            }
+            if (budget != NULL)
+            {
+                rows += parts[k].budget.nRows - budget->nRows;
+                budget->nBytes = parts[k].budget.nBytes > budget->nBytes
+                    ? parts[k].budget.nBytes : budget->nBytes;
+            }
+        }
+        if (budget != NULL)
+        {
+            budget->nRows += rows;
+        }
+        free(threads);
+    }
+
+    /* Components left unsolved after one without a solution. */
+    for (k = 0; k < nParts; ++k)
+    {
+        if (parts[k].eqns != NULL)
+        {
+            freeSystem(parts[k].eqns, parts[k].nEqn, parts[k].nVar + 1);
+        }
+    }
+    free(parts);
+    return res;
+}
+
+#endif
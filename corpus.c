@@ -0,0 +1,326 @@
+#ifndef CORPUS_C
+#define CORPUS_C
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "coeff.h"
+#include "corpus.h"
+#include "util.h"
+#include "zmk.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ *  A corpus is a directory holding the systems 0, 1, 2 ... as dir/N/A and
+ *  dir/N/c, like input/. Reader threads claim the next number, parse that
+ *  system and queue it, solver threads take parsed systems from that queue
+ *  and queue their answers, and the calling thread writes the answers out
+ *  in order as they come. Both queues are bounded, so readers never get
+ *  more than CORPUS_QUEUE systems ahead of the solvers. A system whose
+ *  values do not fit a coefficient is not solved, its answer is
+ *  CORPUS_ERROR.
+ */
+#define CORPUS_ERROR    (-4)
+
+typedef struct corpus_job {
+    size_t index;
+    EQN_T*** eqns;
+    ROW_T nEqn;
+    INT_T nVar;
+    ROW_T nEq;
+    INT_T res;
+} corpus_job_t;
+
+typedef struct corpus_queue {
+    corpus_job_t* jobs[CORPUS_QUEUE];
+    size_t head;
+    size_t count;
+    int producers;          /* Threads that may still put jobs. */
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+} corpus_queue_t;
+
+typedef struct corpus {
+    const char* dir;
+    pthread_mutex_t lock;
+    size_t next;            /* The next system to read. */
+    size_t end;             /* The first system found missing. */
+    corpus_queue_t parsed;
+    corpus_queue_t solved;
+} corpus_t;
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+static void queueInit(corpus_queue_t* q, int producers)
+{
+    q->head = 0;
+    q->count = 0;
+    q->producers = producers;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->notEmpty, NULL);
+    pthread_cond_init(&q->notFull, NULL);
+}
+
+static void queueDestroy(corpus_queue_t* q)
+{
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->notEmpty);
+    pthread_cond_destroy(&q->notFull);
+}
+
+/**
+ *  Adds a job to a queue, waiting for room if it is full.
+ */
+static void queuePut(corpus_queue_t* q, corpus_job_t* job)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->count == CORPUS_QUEUE)
+    {
+        pthread_cond_wait(&q->notFull, &q->lock);
+    }
+    q->jobs[(q->head + q->count++) % CORPUS_QUEUE] = job;
+    pthread_cond_signal(&q->notEmpty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/**
+ *  Takes the oldest job from a queue, waiting for one if it is empty.
+ *
+ *  @return
+ *          The job, or NULL once the queue is empty and every producer has
+ *          closed it.
+ */
+static corpus_job_t* queueGet(corpus_queue_t* q)
+{
+    corpus_job_t* job = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while (!q->count && q->producers)
+    {
+        pthread_cond_wait(&q->notEmpty, &q->lock);
+    }
+    if (q->count)
+    {
+        job = q->jobs[q->head];
+        q->head = (q->head + 1) % CORPUS_QUEUE;
+        --q->count;
+        pthread_cond_signal(&q->notFull);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return job;
+}
+
+/**
+ *  Tells a queue that one of its producers is done.
+ */
+static void queueClose(corpus_queue_t* q)
+{
+    pthread_mutex_lock(&q->lock);
+    --q->producers;
+    pthread_cond_broadcast(&q->notEmpty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Reads and parses systems until one is missing.
+ */
+static void* corpusRead(void* arg)
+{
+    corpus_t* c = (corpus_t*) arg;
+    corpus_job_t* job;
+    FILE* afile;
+    FILE* cfile;
+    char a[BUFSIZ];
+    char cn[BUFSIZ];
+    size_t i;
+    int done;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&c->lock);
+        i = c->next;
+        done = i >= c->end;
+        c->next += !done;
+        pthread_mutex_unlock(&c->lock);
+        if (done)
+        {
+            break;
+        }
+
+        snprintf(a, sizeof a, "%s/%zu/A", c->dir, i);
+        snprintf(cn, sizeof cn, "%s/%zu/c", c->dir, i);
+        afile = fopen(a, "r");
+        cfile = fopen(cn, "r");
+        job = afile && cfile ? (corpus_job_t*) malloc(sizeof *job) : NULL;
+        if (job == NULL)
+        {
+            if (afile != NULL)
+                fclose(afile);
+            if (cfile != NULL)
+                fclose(cfile);
+            pthread_mutex_lock(&c->lock);
+            c->end = i < c->end ? i : c->end;
+            pthread_mutex_unlock(&c->lock);
+            break;
+        }
+
+        job->index = i;
+        job->eqns = parseSystemEq(afile, cfile, &job->nEqn, &job->nVar,
+            &job->nEq);
+        fclose(afile);
+        fclose(cfile);
+        queuePut(&c->parsed, job);
+    }
+    queueClose(&c->parsed);
+    return NULL;
+}
+
+/**
+ *  Solves parsed systems, each within the budget set by {@code BUDGET_ENV}
+ *  if there is one.
+ */
+static void* corpusSolve(void* arg)
+{
+    corpus_t* c = (corpus_t*) arg;
+    corpus_job_t* job;
+    zmk_budget_t budget;
+    short limited;
+
+    while ((job = queueGet(&c->parsed)) != NULL)
+    {
+        limited = budgetFromEnv(&budget);
+        job->res = job->eqns == NULL ? CORPUS_ERROR
+            : zmkSolveEq(job->eqns, job->nEqn, job->nVar, job->nEq, NULL,
+                limited ? &budget : NULL);
+        job->eqns = NULL;
+        queuePut(&c->solved, job);
+    }
+    queueClose(&c->solved);
+    return NULL;
+}
+
+/**
+ *  Solves the systems dir/0, dir/1 ... up to the first one missing,
+ *  overlapping their reading, solving and the writing of the answers.
+ *  <p>
+ *  Answers are written in the order of the systems, one line each holding
+ *  the number of the system and 1 if it has a solution, 0 if it has none,
+ *  "budget" if it ran out of its budget, "unknown" if its coefficients
+ *  overflowed or "error" if its files hold a value that does not fit a
+ *  coefficient.
+ *
+ *  @param dir
+ *          The directory of the corpus.
+ *  @param nReaders
+ *          The number of threads reading and parsing systems.
+ *  @param nSolvers
+ *          The number of threads solving systems, or zero for one per
+ *          online processor.
+ *  @param out
+ *          Where to write the answers.
+ *  @return
+ *          The number of systems solved.
+ */
+int zmkCorpus(const char* dir, int nReaders, int nSolvers, FILE* out)
+{
+    corpus_t c;
+    corpus_job_t* job;
+    corpus_job_t** pending = NULL;
+    pthread_t* threads;
+    size_t nPending = 0;
+    size_t written = 0;
+    size_t size;
+    int i;
+
+    nReaders = nReaders < 1 ? 1 : nReaders;
+    if (nSolvers < 1)
+    {
+        nSolvers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+        nSolvers = nSolvers < 1 ? 1 : nSolvers;
+    }
+
+    c.dir = dir;
+    c.next = 0;
+    c.end = (size_t) -1;
+    pthread_mutex_init(&c.lock, NULL);
+    queueInit(&c.parsed, nReaders);
+    queueInit(&c.solved, nSolvers);
+
+    threads = (pthread_t*) malloc(sizeof(pthread_t) * (nReaders + nSolvers));
+    if (threads == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < nReaders + nSolvers; ++i)
+    {
+        if (pthread_create(threads + i, NULL,
+                i < nReaders ? corpusRead : corpusSolve, &c))
+        {
+            fprintf(stderr, "could not start thread\n");
+            exit(1);
+        }
+    }
+
+    /* Answers that come early wait in pending until their turn. */
+    while ((job = queueGet(&c.solved)) != NULL)
+    {
+        if (job->index >= nPending)
+        {
+            size = job->index + 1 > 2 * nPending ? job->index + 1
+                : 2 * nPending;
+            pending = (corpus_job_t**) realloc(pending,
+                sizeof(corpus_job_t*) * size);
+            if (pending == NULL)
+            {
+                fprintf(stderr, "out of memory\n");
+                exit(1);
+            }
+            memset(pending + nPending, 0,
+                sizeof(corpus_job_t*) * (size - nPending));
+            nPending = size;
+        }
+        pending[job->index] = job;
+
+        while (written < nPending && pending[written] != NULL)
+        {
+            job = pending[written];
+            fprintf(out, "%zu %s\n", job->index, job->res == ZMK_BUDGET
+                ? "budget" : job->res == ZMK_UNKNOWN ? "unknown"
+                : job->res == CORPUS_ERROR ? "error"
+                : job->res ? "1" : "0");
+            free(job);
+            pending[written++] = NULL;
+        }
+        fflush(out);
+    }
+
+    for (i = 0; i < nReaders + nSolvers; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    /* Systems read past a missing one are dropped. */
+    while (nPending > written)
+    {
+        free(pending[--nPending]);
+    }
+    free(pending);
+    free(threads);
+    queueDestroy(&c.parsed);
+    queueDestroy(&c.solved);
+    pthread_mutex_destroy(&c.lock);
+    return (int) written;
+}
+
+#endif
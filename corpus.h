@@ -0,0 +1,14 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stdio.h>
+
+/*
+ *  Parsed systems wait in a queue of at most CORPUS_QUEUE entries for a
+ *  solver, and so do answers for the writer.
+ */
+#define CORPUS_QUEUE    (64)
+
+int zmkCorpus(const char*, int, int, FILE*);
+
+#endif
@@ -0,0 +1,622 @@
+#ifndef DAEMON_C
+#define DAEMON_C
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "cache.h"
+#include "coeff.h"
+#include "daemon.h"
+#include "util.h"
+#include "zmk.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+ *  A stream of systems is read in chunks into {@code buf}. Every complete
+ *  frame in it is parsed into {@code values}, solved and its answer added to
+ *  {@code reply}, which is written once the chunk is used up. Clients that
+ *  send several systems before reading get their answers in one write, and
+ *  the buffers are kept from one system, and one client, to the next.
+ *  <p>
+ *  A text frame is an A file followed by a c file as found in input/, whose
+ *  constants may be marked with '=' to make their rows equalities. A
+ *  binary frame is DAEMON_MAGIC followed by the number of rows and columns
+ *  and, for every row, its coefficients and its constant, all as 32-bit
+ *  integers in host byte order. Each system is answered by a line holding 1
+ *  if it has a solution and 0 if it has none. A system that runs out of the
+ *  budget set by ZMK_BUDGET is answered by "budget" followed by the rows
+ *  generated, the bytes of the largest level and the seconds spent, one
+ *  whose coefficients overflowed, or for which memory ran out, by
+ *  "unknown", and the stream goes on. A
+ *  malformed frame, or one with a value that does not fit a coefficient,
+ *  is answered by "error" and ends the stream.
+ */
+typedef struct daemon {
+    char* buf;
+    size_t len;
+    size_t cap;
+    char* reply;
+    size_t nReply;
+    size_t capReply;
+    long* values;
+    size_t capValues;
+    char* isEq;
+    size_t capEq;
+    long nEqn;
+    long nVar;
+    long nEq;
+    int eof;
+} daemon_t;
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Makes room for {@code n} more bytes in a buffer.
+ *
+ *  @return
+ *          Zero if memory ran out, non-zero otherwise.
+ */
+static int daemonGrow(char** buf, size_t* cap, size_t len, size_t n)
+{
+    char* tmp;
+    size_t c = *cap ? *cap : DAEMON_READ;
+
+    while (c - len < n)
+    {
+        c *= 2;
+    }
+    if (c == *cap)
+    {
+        return 1;
+    }
+    tmp = (char*) realloc(*buf, c);
+    if (tmp == NULL)
+    {
+        return 0;
+    }
+    *buf = tmp;
+    *cap = c;
+    return 1;
+}
+
+/**
+ *  Makes room for the values of a frame of {@code nEqn} rows.
+ *
+ *  @return
+ *          Zero if the frame is too large, non-zero otherwise.
+ */
+static int daemonValues(daemon_t* d, long nEqn, long nVar)
+{
+    size_t n;
+    long* tmp;
+
+    if (nEqn < 0 || nVar < 0 || (INT_T) (nVar + 1) != nVar + 1
+            || (size_t) nEqn > (size_t) -1 / sizeof(long) / (nVar + 1))
+    {
+        return 0;
+    }
+    n = (size_t) nEqn * (nVar + 1);
+    if (n > d->capValues)
+    {
+        tmp = (long*) realloc(d->values, sizeof(long) * n);
+        if (tmp == NULL)
+        {
+            return 0;
+        }
+        d->values = tmp;
+        d->capValues = n;
+    }
+    if (!daemonGrow(&d->isEq, &d->capEq, 0, (size_t) nEqn + 1))
+    {
+        return 0;
+    }
+    memset(d->isEq, 0, (size_t) nEqn);
+    d->nEqn = nEqn;
+    d->nVar = nVar;
+    d->nEq = 0;
+    return 1;
+}
+
+/**
+ *  Reads a number of a text frame.
+ *
+ *  @return
+ *          1 if a number was read, 0 if the buffer ends before it does and
+ *          -1 if there is something else.
+ */
+static int daemonNumber(daemon_t* d, size_t* pos, long* out)
+{
+    size_t i = *pos;
+    size_t start;
+    long v = 0;
+    int neg = 0;
+
+    while (i < d->len && strchr(" \t\r\n", d->buf[i]) != NULL)
+    {
+        ++i;
+    }
+    if (i < d->len && (d->buf[i] == '-' || d->buf[i] == '+'))
+    {
+        neg = d->buf[i++] == '-';
+    }
+    start = i;
+    while (i < d->len && d->buf[i] >= '0' && d->buf[i] <= '9')
+    {
+        if (v > (INT32_MAX - 9) / 10)
+        {
+            return -1;
+        }
+        v = v * 10 + (d->buf[i++] - '0');
+    }
+    if (i == d->len && !d->eof)
+    {
+        return 0;
+    }
+    if (i == start)
+    {
+        return i == d->len ? 0 : -1;
+    }
+    *out = neg ? -v : v;
+    *pos = i;
+    return 1;
+}
+
+/**
+ *  Parses a text frame into {@code values}, row by row with the constant
+ *  of each row after its coefficients, and its '=' markers into
+ *  {@code isEq}.
+ */
+static int daemonText(daemon_t* d, size_t* pos)
+{
+    size_t i = *pos;
+    long nEqn;
+    long nVar;
+    long* row;
+    long n;
+    long r;
+    long k;
+    int res;
+
+    if ((res = daemonNumber(d, &i, &nEqn)) <= 0
+            || (res = daemonNumber(d, &i, &nVar)) <= 0)
+    {
+        return res;
+    }
+    if (!daemonValues(d, nEqn, nVar))
+    {
+        return -1;
+    }
+    for (r = 0; r < nEqn; ++r)
+    {
+        row = d->values + r * (nVar + 1);
+        for (k = 0; k < nVar; ++k)
+        {
+            if ((res = daemonNumber(d, &i, row + k)) <= 0)
+            {
+                return res;
+            }
+        }
+    }
+    if ((res = daemonNumber(d, &i, &n)) <= 0)
+    {
+        return res;
+    }
+    if (n != nEqn)
+    {
+        return -1;
+    }
+    for (r = 0; r < nEqn; ++r)
+    {
+        row = d->values + r * (nVar + 1);
+        while (i < d->len && strchr(" \t\r\n", d->buf[i]) != NULL)
+        {
+            ++i;
+        }
+        if (i < d->len && d->buf[i] == '=')
+        {
+            d->isEq[r] = 1;
+            d->nEq++;
+            ++i;
+        }
+        if ((res = daemonNumber(d, &i, row + nVar)) <= 0)
+        {
+            return res;
+        }
+    }
+    *pos = i;
+    return 1;
+}
+
+/**
+ *  Parses a binary frame into {@code values}.
+ */
+static int daemonBinary(daemon_t* d, size_t* pos)
+{
+    size_t i = *pos + 4;
+    int32_t head[2];
+    int32_t v;
+    size_t n;
+    size_t k;
+
+    if (d->len - i < sizeof head)
+    {
+        return 0;
+    }
+    memcpy(head, d->buf + i, sizeof head);
+    i += sizeof head;
+    if (!daemonValues(d, head[0], head[1]))
+    {
+        return -1;
+    }
+    n = (size_t) head[0] * (head[1] + 1);
+    if ((d->len - i) / sizeof v < n)
+    {
+        return 0;
+    }
+    for (k = 0; k < n; ++k)
+    {
+        memcpy(&v, d->buf + i, sizeof v);
+        d->values[k] = v;
+        i += sizeof v;
+    }
+    *pos = i;
+    return 1;
+}
+
+/**
+ *  Parses the next frame of the buffer.
+ *
+ *  @return
+ *          1 if a frame was parsed and {@code pos} moved past it, 0 if the
+ *          buffer holds no complete frame and -1 if it is malformed.
+ */
+static int daemonFrame(daemon_t* d, size_t* pos)
+{
+    size_t i = *pos;
+
+    while (i < d->len && strchr(" \t\r\n", d->buf[i]) != NULL)
+    {
+        ++i;
+    }
+    if (i == d->len)
+    {
+        *pos = i;
+        return 0;
+    }
+    if (d->len - i < 4)
+    {
+        if (memcmp(d->buf + i, DAEMON_MAGIC, d->len - i) == 0)
+            return d->eof ? -1 : 0;
+    } else if (memcmp(d->buf + i, DAEMON_MAGIC, 4) == 0) {
+        *pos = i;
+        return daemonBinary(d, pos);
+    }
+    *pos = i;
+    return daemonText(d, pos);
+}
+
+/**
+ *  Checks that every value of the last frame read fits a coefficient, as
+ *  does its negation.
+ *
+ *  @return
+ *          Non-zero if the frame can be solved.
+ */
+static int daemonFits(const daemon_t* d)
+{
+    size_t n = (size_t) d->nEqn * (d->nVar + 1);
+    size_t k;
+
+    for (k = 0; k < n; ++k)
+    {
+        if (d->values[k] != (INT_T) d->values[k]
+                || -d->values[k] != (INT_T) -d->values[k])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ *  Builds the system of the last frame read and decides it, through the
+ *  cache if there is one. Equalities are added as two opposite rows, as
+ *  {@code parseSystem} reads them. The values have been checked by
+ *  {@code daemonFits}.
+ *
+ *  @param budget
+ *          The budget of the system, may be NULL.
+ *  @return
+ *          {@code ZMK_SAT} or {@code ZMK_UNSAT}, {@code ZMK_BUDGET} if the
+ *          budget ran out, {@code ZMK_UNKNOWN} if the coefficients of the
+ *          solve overflowed or memory ran out.
+ */
+static INT_T daemonSolve(daemon_t* d, cache_t* cache, zmk_budget_t* budget)
+{
+    ROW_T nEqn = (ROW_T) (d->nEqn + d->nEq);
+    INT_T nVar = (INT_T) d->nVar;
+    EQN_T*** eqns = (EQN_T***) calloc(nEqn + 1, sizeof(EQN_T**));
+    cache_key_t key;
+    long* row;
+    INT_T res;
+    INT_T j;
+    ROW_T i;
+    ROW_T e = (ROW_T) d->nEqn;
+    short ok = eqns != NULL;
+
+    for (i = 0; ok && i < (ROW_T) d->nEqn; ++i)
+    {
+        row = d->values + i * (nVar + 1);
+        eqns[i] = (EQN_T**) malloc(sizeof(EQN_T*) * (nVar + 1));
+        if (eqns[i] == NULL)
+        {
+            ok = 0;
+            break;
+        }
+        for (j = 0; j < nVar; ++j)
+        {
+            eqns[i][j] = newCoeff((INT_T) row[j], 1);
+        }
+        eqns[i][nVar] = newCoeff((INT_T) -row[nVar], 1);
+        if (d->isEq[i])
+        {
+            eqns[e] = (EQN_T**) malloc(sizeof(EQN_T*) * (nVar + 1));
+            if (eqns[e] == NULL)
+            {
+                ok = 0;
+                break;
+            }
+            for (j = 0; j <= nVar; ++j)
+            {
+                eqns[e][j] = newCoeff(-eqns[i][j]->nom, 1);
+            }
+            ++e;
+        }
+    }
+
+    /* Out of memory, the rows built so far go and the frame is unknown. */
+    if (!ok)
+    {
+        for (i = 0; eqns != NULL && i < nEqn; ++i)
+        {
+            if (eqns[i] != NULL)
+            {
+                freeEquation(eqns[i], nVar + 1);
+            }
+        }
+        free(eqns);
+        return ZMK_UNKNOWN;
+    }
+
+    if (cache == NULL || !cacheKey(eqns, nEqn, nVar, &key))
+    {
+        return zmkSolve(eqns, nEqn, nVar, NULL, budget);
+    }
+    res = cacheLookup(cache, &key);
+    if (res != ZMK_UNKNOWN)
+    {
+        freeSystem(eqns, nEqn, nVar + 1);
+        return res;
+    }
+    res = zmkSolve(eqns, nEqn, nVar, NULL, budget);
+    cacheInsert(cache, &key, res);
+    return res;
+}
+
+/**
+ *  Adds an answer to the reply.
+ *
+ *  @return
+ *          -1 if memory ran out, 0 otherwise.
+ */
+static int daemonReply(daemon_t* d, const char* answer)
+{
+    size_t len = strlen(answer);
+
+    if (!daemonGrow(&d->reply, &d->capReply, d->nReply, len))
+    {
+        return -1;
+    }
+    memcpy(d->reply + d->nReply, answer, len);
+    d->nReply += len;
+    return 0;
+}
+
+/**
+ *  Writes all of a buffer.
+ */
+static int daemonWrite(int fd, const char* buf, size_t len)
+{
+    ssize_t n;
+
+    while (len)
+    {
+        n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        } else if (n <= 0) {
+            return 0;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 1;
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Answers a stream of systems until it ends.
+ *
+ *  @param in
+ *          The descriptor systems are read from.
+ *  @param out
+ *          The descriptor answers are written to.
+ *  @param cache
+ *          Results kept between systems, may be NULL.
+ *  @return
+ *          Zero if the stream ended after a complete frame, -1 otherwise.
+ */
+int zmkDaemon(int in, int out, cache_t* cache)
+{
+    static daemon_t d;
+    zmk_budget_t budget;
+    char line[80];
+    short limited;
+    ssize_t n;
+    size_t pos;
+    int res = 0;
+
+    d.len = 0;
+    d.eof = 0;
+    while (!d.eof && !res)
+    {
+        if (!daemonGrow(&d.buf, &d.cap, d.len, DAEMON_READ))
+        {
+            return -1;
+        }
+        n = read(in, d.buf + d.len, d.cap - d.len);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        d.eof = n <= 0;
+        d.len += n > 0 ? n : 0;
+
+        pos = 0;
+        d.nReply = 0;
+        while ((res = daemonFrame(&d, &pos)) > 0)
+        {
+            if (!daemonFits(&d))
+            {
+                res = -1;
+                break;
+            }
+            limited = budgetFromEnv(&budget);
+            switch (daemonSolve(&d, cache, limited ? &budget : NULL))
+            {
+            case ZMK_SAT:
+                res = daemonReply(&d, "1\n");
+                break;
+            case ZMK_UNSAT:
+                res = daemonReply(&d, "0\n");
+                break;
+            case ZMK_BUDGET:
+                snprintf(line, sizeof line, "budget %zu %zu %.3f\n",
+                    budget.nRows, budget.nBytes, budgetElapsed(&budget));
+                res = daemonReply(&d, line);
+                break;
+            case ZMK_UNKNOWN:
+                res = daemonReply(&d, "unknown\n");
+                break;
+            default:
+                res = -1;
+            }
+            if (res < 0)
+            {
+                break;
+            }
+        }
+
+        /* A frame cut short by the end of the stream is malformed too. */
+        if (!res && d.eof && pos < d.len)
+        {
+            res = -1;
+        }
+        if (res < 0)
+        {
+            daemonReply(&d, "error\n");
+        }
+        if (!daemonWrite(out, d.reply, d.nReply))
+        {
+            return -1;
+        }
+
+        memmove(d.buf, d.buf + pos, d.len - pos);
+        d.len -= pos;
+    }
+    return res;
+}
+
+/**
+ *  Runs the solver as a daemon, answering systems read from standard input
+ *  or from clients of a Unix domain socket, one client at a time. Results
+ *  are cached for as long as the daemon runs, and kept in the file named by
+ *  {@code CACHE_ENV} if it is set.
+ *
+ *  @param path
+ *          The path of the socket to create, NULL for standard input.
+ *  @return
+ *          Zero if standard input ended after a complete frame, non-zero
+ *          otherwise. Serving a socket only returns on errors.
+ */
+int zmkServe(const char* path)
+{
+    struct sockaddr_un addr;
+    cache_t* cache = newCache(CACHE_SIZE);
+    const char* file = getenv(CACHE_ENV);
+    int sock;
+    int fd;
+    int res = 1;
+
+    if (file != NULL && cache != NULL && !loadCache(cache, file))
+    {
+        fprintf(stderr, "ignoring cache file %s\n", file);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    if (path == NULL)
+    {
+        res = zmkDaemon(STDIN_FILENO, STDOUT_FILENO, cache) != 0;
+    } else if (strlen(path) >= sizeof addr.sun_path) {
+        fprintf(stderr, "socket path too long: %s\n", path);
+    } else if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+        perror("socket");
+    } else {
+        memset(&addr, 0, sizeof addr);
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path);
+        unlink(path);
+        if (bind(sock, (struct sockaddr*) &addr, sizeof addr) < 0
+                || listen(sock, 16) < 0)
+        {
+            perror(path);
+        } else {
+            while ((fd = accept(sock, NULL, NULL)) >= 0 || errno == EINTR)
+            {
+                if (fd >= 0)
+                {
+                    zmkDaemon(fd, fd, cache);
+                    close(fd);
+                    if (file != NULL && cache != NULL)
+                    {
+                        saveCache(cache, file);
+                    }
+                }
+            }
+            perror("accept");
+        }
+        close(sock);
+    }
+
+    if (file != NULL && cache != NULL && !saveCache(cache, file))
+    {
+        fprintf(stderr, "could not save cache to %s\n", file);
+    }
+    freeCache(cache);
+    return res;
+}
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "cache.h"
+
+/*
+ *  Binary frames start with this tag, read as four bytes. Anything else is
+ *  read as a text frame.
+ */
+#define DAEMON_MAGIC    "ZMKB"
+#define DAEMON_READ     (1 << 16)
+
+int zmkDaemon(int, int, cache_t*);
+int zmkServe(const char*);
+
+#endif
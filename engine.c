@@ -0,0 +1,180 @@
+#ifndef ENGINE_C
+#define ENGINE_C
+
+#include "engine.h"
+#include "zmk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ *  The engines linked into the program, in order of their names so that
+ *  the order in which the objects were linked does not show.
+ */
+static zmk_engine_t engines[ENGINES_MAX];
+static size_t nEngines;
+
+static const char* flagNames[] = {
+    "exact", "equalities", "budget", "cache", "threads", "fixed",
+};
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Checks whether the {@code len} characters at {@code token} occur in a
+ *  name.
+ */
+static short nameHas(const char* name, const char* token, size_t len)
+{
+    size_t n = strlen(name);
+    size_t i;
+
+    for (i = 0; i + len <= n; ++i)
+    {
+        if (strncmp(name + i, token, len) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ========= *
+ *  Object.  *
+ * ========= */
+
+/**
+ *  Adds an engine to the registry, called through {@code ZMK_ENGINE}
+ *  before main runs.
+ *
+ *  @param name
+ *          The name of the engine, unique among the engines.
+ *  @param func
+ *          The driver function of the engine.
+ *  @param flags
+ *          What the engine can do, the {@code ENGINE_} flags.
+ */
+void engineRegister(const char* name, zmk_fm_t func, unsigned flags)
+{
+    size_t i;
+
+    if (nEngines == ENGINES_MAX)
+    {
+        fprintf(stderr, "too many engines, leaving out %s\n", name);
+        return;
+    }
+    for (i = nEngines; i > 0 && strcmp(engines[i - 1].name, name) > 0; --i)
+    {
+        engines[i] = engines[i - 1];
+    }
+    engines[i].name = name;
+    engines[i].func = func;
+    engines[i].flags = flags;
+    nEngines++;
+}
+
+/**
+ *  Returns the number of engines registered.
+ */
+size_t engineCount(void)
+{
+    return nEngines;
+}
+
+/**
+ *  Returns the engine at a position of the registry.
+ */
+const zmk_engine_t* engineAt(size_t i)
+{
+    return i < nEngines ? &engines[i] : NULL;
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Checks an engine against a filter of comma-separated parts of names,
+ *  such as "fast,small". A part preceded by '-' leaves out the engines whose
+ *  names hold it, so "-cached" is every engine but zmk_fm_cached.
+ *
+ *  @param engine
+ *          The engine.
+ *  @param filter
+ *          The filter, NULL or empty for every engine.
+ *  @return
+ *          Non-zero if the engine passes the filter.
+ */
+short engineMatch(const zmk_engine_t* engine, const char* filter)
+{
+    const char* token;
+    size_t len;
+    short wanted = 0;
+    short any = 0;
+    short exclude;
+
+    if (filter == NULL)
+    {
+        return 1;
+    }
+    for (token = filter; *token; token += len + (token[len] == ','))
+    {
+        len = strcspn(token, ",");
+        exclude = *token == '-';
+        if (len - exclude == 0)
+        {
+            continue;
+        }
+        if (nameHas(engine->name, token + exclude, len - exclude))
+        {
+            if (exclude)
+            {
+                return 0;
+            }
+            wanted = 1;
+        }
+        any |= !exclude;
+    }
+    return wanted || !any;
+}
+
+/**
+ *  Returns what a driver run once returns for the result of a solve.
+ *
+ *  @param res
+ *          The result, one of the {@code ZMK_} codes.
+ *  @return
+ *          1 or 0 if the solve decided the system, {@code ENGINE_UNDECIDED}
+ *          otherwise.
+ */
+unsigned long long engineAnswer(int res)
+{
+    return res == ZMK_SAT || res == ZMK_UNSAT ? (unsigned long long) res
+        : ENGINE_UNDECIDED;
+}
+
+/**
+ *  Prints every engine with the flags it registered with, one per line.
+ */
+void printEngines(void)
+{
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < nEngines; ++i)
+    {
+        printf("%-20s", engines[i].name);
+        for (j = 0; j < sizeof flagNames / sizeof flagNames[0]; ++j)
+        {
+            if (engines[i].flags & (1u << j))
+            {
+                printf(" %s", flagNames[j]);
+            }
+        }
+        putchar('\n');
+    }
+}
+
+#endif
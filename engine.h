@@ -0,0 +1,58 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stddef.h>
+
+/*
+ *  What an engine can do, as flags it registers with.
+ */
+#define ENGINE_EXACT        (1 << 0)    /* Answers in exact arithmetic. */
+#define ENGINE_EQUALITIES   (1 << 1)    /* Keeps '=' rows as equalities. */
+#define ENGINE_BUDGET       (1 << 2)    /* Stops within ZMK_BUDGET. */
+#define ENGINE_CACHE        (1 << 3)    /* Remembers systems it solved. */
+#define ENGINE_THREADS      (1 << 4)    /* Solves on several threads. */
+#define ENGINE_FIXED        (1 << 5)    /* Solves in a fixed buffer. */
+
+#define ENGINES_MAX         (32)
+
+/*
+ *  What a driver run once returns for a system it did not decide, because
+ *  it ran out of its budget or its buffer, or a value overflowed. It is
+ *  neither answer, so the run fails its test instead of passing by chance.
+ */
+#define ENGINE_UNDECIDED    (2)
+
+/**
+ *  A solver the benchmark can run, as found in the driver files: given the
+ *  files of A and c and zero seconds it returns 1 if the system has a
+ *  solution and 0 if it has none, given more seconds the number of times it
+ *  solved the system in that time.
+ */
+typedef unsigned long long (*zmk_fm_t)(char*, char*, int);
+
+typedef struct zmk_engine {
+    const char* name;
+    zmk_fm_t func;
+    unsigned flags;
+} zmk_engine_t;
+
+void engineRegister(const char*, zmk_fm_t, unsigned);
+size_t engineCount(void);
+const zmk_engine_t* engineAt(size_t);
+short engineMatch(const zmk_engine_t*, const char*);
+void printEngines(void);
+unsigned long long engineAnswer(int);
+
+/*
+ *  Registers the driver function fn under its own name before main runs,
+ *  written once at the end of the file that defines it, so that linking the
+ *  object in is all it takes to add an engine to the benchmark.
+ */
+#define ZMK_ENGINE(fn, flags)                                   \
+    static void register_##fn(void) __attribute__((constructor)); \
+    static void register_##fn(void)                             \
+    {                                                           \
+        engineRegister(#fn, fn, flags);                         \
+    }
+
+#endif
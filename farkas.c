@@ -0,0 +1,1172 @@
+#ifndef FARKAS_C
+#define FARKAS_C
+
+#include "coeff.h"
+#include "farkas.h"
+#include "util.h"
+#include "zmk.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ *  Rows of zmkFarkas are integers of width nVar + 1 + nEqn: the
+ *  coefficients, the constant and then the multiplier of every row of the
+ *  system in the combination the row stands for. A row of the system
+ *  starts out as itself with multiplier one, an equality as two opposite
+ *  rows with multipliers one and minus one.
+ */
+#define FARKAS_T        long long
+
+/*
+ *  The number of equalities rhsRead is to find out rather than check.
+ */
+#define RHS_UNSET       ((ROW_T) -1)
+
+/*
+ *  The multipliers of a row as handed to qsort, with their number.
+ */
+typedef struct farkas_row {
+    const FARKAS_T* y;
+    ROW_T nEqn;
+} farkas_row_t;
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Returns the number of rows of the system a row is combined from.
+ */
+static ROW_T farkasSupport(const FARKAS_T* mult, ROW_T nEqn)
+{
+    ROW_T n = 0;
+    ROW_T i;
+
+    for (i = 0; i < nEqn; ++i)
+    {
+        n += mult[i] != 0;
+    }
+    return n;
+}
+
+/**
+ *  Writes the combination of a row with a positive and a row with a negative
+ *  coefficient in column {@code k}, multipliers included, divided by the
+ *  gcd of its entries.
+ *
+ *  @return
+ *          Non-zero if a value overflowed.
+ */
+static int farkasCombine(FARKAS_T* out, const FARKAS_T* pos,
+        const FARKAS_T* neg, INT_T k, size_t W)
+{
+    FARKAS_T a = -neg[k];
+    FARKAS_T c = pos[k];
+    FARKAS_T x;
+    FARKAS_T y;
+    FARKAS_T g = 0;
+    int overflow = 0;
+    size_t j;
+
+    for (j = 0; j < W; ++j)
+    {
+        overflow |= __builtin_mul_overflow(pos[j], a, &x);
+        overflow |= __builtin_mul_overflow(neg[j], c, &y);
+        overflow |= __builtin_add_overflow(x, y, &out[j]);
+        g = gcdLong(g, out[j]);
+    }
+    for (j = 0; g > 1 && j < W; ++j)
+    {
+        out[j] /= g;
+    }
+    return overflow;
+}
+
+/**
+ *  Fills in a certificate from the multipliers of a contradicting row.
+ *
+ *  @return
+ *          Zero if memory ran out.
+ */
+static short farkasFill(zmk_farkas_t* cert, const FARKAS_T* mult,
+        ROW_T nEqn)
+{
+    ROW_T i;
+
+    cert->nEqn = nEqn;
+    cert->nConflict = 0;
+    cert->y = (FARKAS_T*) malloc(sizeof(FARKAS_T) * (nEqn + 1));
+    cert->conflict = (ROW_T*) malloc(sizeof(ROW_T) * (nEqn + 1));
+    if (cert->y == NULL || cert->conflict == NULL)
+    {
+        freeFarkas(cert);
+        return 0;
+    }
+    for (i = 0; i < nEqn; ++i)
+    {
+        cert->y[i] = mult[i];
+        if (mult[i])
+        {
+            cert->conflict[cert->nConflict++] = i;
+        }
+    }
+    return 1;
+}
+
+/**
+ *  Frees the arrays of a certificate.
+ */
+void freeFarkas(zmk_farkas_t* cert)
+{
+    free(cert->y);
+    free(cert->conflict);
+    cert->y = NULL;
+    cert->conflict = NULL;
+    cert->nConflict = 0;
+}
+
+/**
+ *  Builds the rows zmkFarkas starts from.
+ *
+ *  @param constants
+ *          Zero to leave the constants out, as if they were all zero.
+ *  @return
+ *          The {@code nEqn + nEq} rows, or NULL if a row does not fit or
+ *          memory ran out.
+ */
+static FARKAS_T* farkasRows(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, ROW_T nEq,
+        short constants)
+{
+    size_t W = (size_t) nVar + 1 + nEqn;
+    size_t n = nEqn + nEq;
+    FARKAS_T* rows = (FARKAS_T*) calloc(n * W + 1, sizeof(FARKAS_T));
+    FARKAS_T* r;
+    size_t i;
+    size_t j;
+
+    for (i = 0; rows != NULL && i < nEqn; ++i)
+    {
+        r = rows + i * W;
+        if (!integerEquation(eqns[i], nVar, r))
+        {
+            free(rows);
+            return NULL;
+        }
+        r[nVar] = constants ? r[nVar] : 0;
+        r[nVar + 1 + i] = 1;
+    }
+    for (i = 0; rows != NULL && i < nEq; ++i)
+    {
+        for (j = 0; j < W; ++j)
+        {
+            rows[(nEqn + i) * W + j] = -rows[i * W + j];
+        }
+    }
+    return rows;
+}
+
+/**
+ *  Returns the row without variables and with a positive constant that is
+ *  combined from the fewest rows of the system, or NULL if there is none.
+ */
+static const FARKAS_T* farkasConflict(const FARKAS_T* rows, size_t n,
+        INT_T nVar, ROW_T nEqn)
+{
+    size_t W = (size_t) nVar + 1 + nEqn;
+    const FARKAS_T* best = NULL;
+    ROW_T least = 0;
+    ROW_T support;
+    size_t i;
+    INT_T j;
+
+    for (i = 0; i < n; ++i)
+    {
+        for (j = 0; j < nVar && !rows[i * W + j]; ++j)
+            ;
+        if (j == nVar && rows[i * W + nVar] > 0)
+        {
+            support = farkasSupport(rows + i * W + nVar + 1, nEqn);
+            if (best == NULL || support < least)
+            {
+                best = rows + i * W;
+                least = support;
+            }
+        }
+    }
+    return best;
+}
+
+/**
+ *  Keeps a row of the level that leaves a single variable {@code j} if it
+ *  is tighter than the row kept in its place. The first slot of
+ *  {@code kept} holds the tightest upper bound on {@code j}, the second the
+ *  tightest lower bound and the third the row without variables and with a
+ *  positive constant that is combined from the fewest rows of the system.
+ *  An empty slot is all zero.
+ *
+ *  @param j
+ *          The variable left, or -1 if there is none.
+ *  @return
+ *          Non-zero if a value overflowed.
+ */
+static int farkasKeep(FARKAS_T* kept, const FARKAS_T* row, INT_T j,
+        INT_T nVar, ROW_T nEqn)
+{
+    size_t W = (size_t) nVar + 1 + nEqn;
+    FARKAS_T c = j < 0 ? 0 : row[j];
+    FARKAS_T* slot = kept + (c > 0 ? 0 : c < 0 ? 1 : 2) * W;
+    FARKAS_T x;
+    FARKAS_T y;
+    int overflow = 0;
+    short keep;
+
+    if (!c)
+    {
+        keep = row[nVar] > 0 && (slot[nVar] <= 0
+            || farkasSupport(row + nVar + 1, nEqn)
+                < farkasSupport(slot + nVar + 1, nEqn));
+    }
+    else if (!slot[j])
+    {
+        keep = 1;
+    }
+    else
+    {
+        /* The tighter bound has the larger constant over |c|. */
+        overflow |= __builtin_mul_overflow(row[nVar], slot[j], &x);
+        overflow |= __builtin_mul_overflow(slot[nVar], c, &y);
+        keep = c > 0 ? x > y : x < y;
+    }
+    if (keep && !overflow)
+    {
+        memcpy(slot, row, sizeof(FARKAS_T) * W);
+    }
+    return overflow;
+}
+
+/**
+ *  Makes room for twice as many rows in a level, charging them to the
+ *  budget.
+ *
+ *  @param next
+ *          The level, moved by the reallocation.
+ *  @param out
+ *          The end of its rows, moved along with it.
+ *  @param cap
+ *          The number of rows it has room for, doubled.
+ *  @return
+ *          {@code ZMK_UNKNOWN} if the size overflowed or memory ran out,
+ *          {@code ZMK_BUDGET}, or zero.
+ */
+static INT_T farkasGrow(FARKAS_T** next, FARKAS_T** out, size_t* cap,
+        size_t W, zmk_budget_t* budget)
+{
+    size_t used = *out - *next;
+    size_t p;
+    FARKAS_T* grown;
+
+    if (__builtin_mul_overflow(*cap, 2 * W * sizeof(FARKAS_T), &p))
+    {
+        return ZMK_UNKNOWN;
+    }
+    if (budgetLevel(budget, *cap, p))
+    {
+        return ZMK_BUDGET;
+    }
+    grown = (FARKAS_T*) realloc(*next, p + sizeof(FARKAS_T));
+    if (grown == NULL)
+    {
+        return ZMK_UNKNOWN;
+    }
+    *next = grown;
+    *out = grown + used;
+    *cap *= 2;
+    return 0;
+}
+
+/**
+ *  Eliminates variables from rows built by {@code farkasRows} until none is
+ *  left or a row contradicts.
+ *  <p>
+ *  Each level eliminates the variable that generates the fewest rows. A
+ *  generated row combined from more rows of the system than one more than
+ *  the number of variables eliminated so far is implied by the others, by
+ *  the rule of Chernikov and Kohler, and dropped. The rule only looks at
+ *  the multipliers, so it holds whatever the constants are. A level grows
+ *  as its rows survive the rule, rather than being sized for every pair.
+ *  <p>
+ *  With the constants in place, the level that leaves a single variable
+ *  keeps only its tightest upper and lower bound and its best
+ *  contradicting row, which decide it all the same.
+ *
+ *  @param rows
+ *          The rows, replaced by those of each level.
+ *  @param n
+ *          The number of rows, updated with them.
+ *  @param settle
+ *          Non-zero if the rows carry their constants, so that the last
+ *          variable may be settled by its bounds.
+ *  @return
+ *          {@code ZMK_UNSAT} if a row contradicts, {@code ZMK_SAT} once the
+ *          rows have no variables left, {@code ZMK_UNKNOWN} if a value
+ *          overflowed or memory ran out, or {@code ZMK_BUDGET}.
+ */
+static INT_T farkasProject(FARKAS_T** rows, size_t* n, INT_T nVar,
+        ROW_T nEqn, short settle, zmk_budget_t* budget)
+{
+    size_t W = (size_t) nVar + 1 + nEqn;
+    size_t nZero;
+    size_t nPos;
+    size_t nNeg;
+    size_t cap;
+    size_t i;
+    size_t p;
+    size_t q;
+    long long cost;
+    long long best;
+    FARKAS_T* r = *rows;
+    FARKAS_T* next;
+    FARKAS_T* out;
+    ROW_T eliminated = 0;
+    INT_T res = ZMK_UNKNOWN;
+    INT_T grown;
+    int overflow = 0;
+    short single;
+    INT_T active;
+    INT_T first;
+    INT_T left;
+    INT_T j;
+    INT_T k;
+
+    while (res == ZMK_UNKNOWN && !overflow)
+    {
+        if (farkasConflict(r, *n, nVar, nEqn) != NULL)
+        {
+            return ZMK_UNSAT;
+        }
+
+        /* The variable generating the fewest rows. */
+        best = -1;
+        k = -1;
+        active = 0;
+        first = left = -1;
+        for (j = 0; j < nVar; ++j)
+        {
+            nPos = nNeg = 0;
+            for (i = 0; i < *n; ++i)
+            {
+                nPos += r[i * W + j] > 0;
+                nNeg += r[i * W + j] < 0;
+            }
+            cost = (long long) (nPos * nNeg) - (long long) (nPos + nNeg);
+            if (nPos || nNeg)
+            {
+                ++active;
+                first = first < 0 ? j : first;
+                left = j;
+            }
+            if ((nPos || nNeg) && (k < 0 || cost < best))
+            {
+                best = cost;
+                k = j;
+            }
+        }
+        if (k < 0)
+        {
+            return ZMK_SAT;
+        }
+        single = settle && active <= 2;
+        left = active < 2 ? -1 : first == k ? left : first;
+
+        nZero = nPos = nNeg = 0;
+        for (i = 0; i < *n; ++i)
+        {
+            nZero += !r[i * W + k];
+            nPos += r[i * W + k] > 0;
+            nNeg += r[i * W + k] < 0;
+        }
+        cap = single ? 4 : nZero + nPos + nNeg;
+        if (__builtin_mul_overflow(cap, W * sizeof(FARKAS_T), &p))
+        {
+            return ZMK_UNKNOWN;
+        }
+        if (budgetLevel(budget, cap, p))
+        {
+            return ZMK_BUDGET;
+        }
+        next = (FARKAS_T*) calloc(cap * W + 1, sizeof(FARKAS_T));
+        if (next == NULL)
+        {
+            return ZMK_UNKNOWN;
+        }
+
+        ++eliminated;
+        out = single ? next + 3 * W : next;
+        for (i = 0; i < *n && !overflow; ++i)
+        {
+            if (r[i * W + k])
+            {
+                continue;
+            }
+            if (single)
+            {
+                overflow = farkasKeep(next, r + i * W, left, nVar, nEqn);
+            }
+            else
+            {
+                memcpy(out, r + i * W, sizeof(FARKAS_T) * W);
+                out += W;
+            }
+        }
+        for (p = 0; p < *n && !overflow && res == ZMK_UNKNOWN; ++p)
+        {
+            if (r[p * W + k] <= 0)
+            {
+                continue;
+            }
+            for (q = 0; q < *n && !overflow; ++q)
+            {
+                if (r[q * W + k] >= 0)
+                {
+                    continue;
+                }
+                if (budgetCheck(budget))
+                {
+                    res = ZMK_BUDGET;
+                    break;
+                }
+                if (!single && (size_t) (out - next) / W == cap)
+                {
+                    grown = farkasGrow(&next, &out, &cap, W, budget);
+                    if (grown)
+                    {
+                        free(next);
+                        return grown;
+                    }
+                }
+                overflow = farkasCombine(out, r + p * W, r + q * W, k, W);
+                if (single)
+                {
+                    overflow |= farkasKeep(next, out, left, nVar, nEqn);
+                }
+                else if (farkasSupport(out + nVar + 1, nEqn)
+                        <= eliminated + 1)
+                {
+                    out += W;
+                }
+            }
+        }
+        if (single)
+        {
+            /* Move the kept rows together, dropping the empty slots. */
+            out = next;
+            for (i = 0; i < 3; ++i)
+            {
+                if (i < 2 ? left >= 0 && next[i * W + left]
+                        : next[i * W + nVar] > 0)
+                {
+                    memmove(out, next + i * W, sizeof(FARKAS_T) * W);
+                    out += W;
+                }
+            }
+        }
+        free(r);
+        *rows = r = next;
+        *n = (out - next) / W;
+    }
+    return res;
+}
+
+/**
+ *  Orders rows by their multipliers, so that equal ones end up next to each
+ *  other.
+ */
+static int compareFarkasRows(const void* ap, const void* bp)
+{
+    const farkas_row_t* a = (const farkas_row_t*) ap;
+    const farkas_row_t* b = (const farkas_row_t*) bp;
+    ROW_T i;
+
+    for (i = 0; i < a->nEqn; ++i)
+    {
+        if (a->y[i] != b->y[i])
+        {
+            return a->y[i] < b->y[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ *  Frees the arrays of a projection.
+ */
+void freeRhs(zmk_rhs_t* rhs)
+{
+    free(rhs->start);
+    free(rhs->col);
+    free(rhs->y);
+    free(rhs->weight);
+    memset(rhs, 0, sizeof *rhs);
+}
+
+/**
+ *  Reads the constants of a file c as rows of the form {@code a x <= c},
+ *  ordered like {@code parseSystemEq} orders them, equalities first.
+ *
+ *  @param cname
+ *          The file.
+ *  @param nEqn
+ *          The number of rows the file should have.
+ *  @param isEq
+ *          Whether each row, in the order of the file, is an equality. Set
+ *          from the file if {@code *nEq} is {@code RHS_UNSET}, checked
+ *          against it otherwise.
+ *  @param nEq
+ *          The number of equalities, or {@code RHS_UNSET} to set it.
+ *  @param c
+ *          Where to write the constants.
+ *  @param stride
+ *          The distance between the constants of two rows in {@code c}.
+ *  @return
+ *          Zero if the file could not be read, does not match or holds a
+ *          value that does not fit a coefficient.
+ */
+static short rhsRead(const char* cname, ROW_T nEqn, char* isEq, ROW_T* nEq,
+        INT_T* c, size_t stride)
+{
+    FILE* cfile = fopen(cname, "r");
+    long* value = (long*) malloc(sizeof(long) * (nEqn + 1));
+    char mark[2];
+    short marked;
+    short ok;
+    size_t m = 0;
+    ROW_T nFound = 0;
+    ROW_T eq = 0;
+    ROW_T ineq = 0;
+    ROW_T i;
+
+    ok = cfile != NULL && value != NULL && fscanf(cfile, "%zu", &m) == 1
+        && m == nEqn;
+    for (i = 0; ok && i < nEqn; ++i)
+    {
+        marked = fscanf(cfile, " %1[=]", mark) == 1;
+        ok = fscanf(cfile, "%ld", value + i) == 1
+            && value[i] == (INT_T) value[i]
+            && -value[i] == (INT_T) -value[i];
+        if (*nEq == RHS_UNSET)
+            isEq[i] = marked;
+        else
+            ok = ok && isEq[i] == marked;
+        nFound += marked;
+    }
+    if (ok && *nEq == RHS_UNSET)
+    {
+        *nEq = nFound;
+    }
+    for (i = 0; ok && i < nEqn; ++i)
+    {
+        c[(isEq[i] ? eq++ : *nEq + ineq++) * stride] = (INT_T) value[i];
+    }
+
+    if (cfile != NULL)
+    {
+        fclose(cfile);
+    }
+    free(value);
+    return ok;
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Performs Fourier-Motzkin elimination while keeping track of how every
+ *  row is combined from the rows of the system, so that a system without a
+ *  solution comes with a Farkas certificate for it. Of the rows without
+ *  variables and with a positive constant, the one combined from the fewest
+ *  rows of the system becomes the certificate.
+ *  <p>
+ *  The system is left untouched.
+ *
+ *  @param eqns
+ *          The system of equations, as read by {@code parseSystemEq}.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param nEq
+ *          The number of equalities at the front of the system.
+ *  @param budget
+ *          The budget of the solve, may be NULL.
+ *  @param cert
+ *          Filled in with the certificate if there is no solution, to be
+ *          freed with {@code freeFarkas}.
+ *  @return
+ *          {@code ZMK_SAT}, {@code ZMK_UNSAT}, {@code ZMK_UNKNOWN} if a value
+ *          overflowed or memory ran out, or {@code ZMK_BUDGET}.
+ */
+INT_T zmkFarkas(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, ROW_T nEq,
+        zmk_budget_t* budget, zmk_farkas_t* cert)
+{
+    FARKAS_T* rows = farkasRows(eqns, nEqn, nVar, nEq, 1);
+    size_t n = nEqn + nEq;
+    INT_T res = ZMK_UNKNOWN;
+
+    cert->y = NULL;
+    cert->conflict = NULL;
+    cert->nConflict = 0;
+    if (rows != NULL)
+    {
+        res = farkasProject(&rows, &n, nVar, nEqn, 1, budget);
+    }
+    if (res == ZMK_UNSAT && !farkasFill(cert,
+            farkasConflict(rows, n, nVar, nEqn) + nVar + 1, nEqn))
+    {
+        res = ZMK_UNKNOWN;
+    }
+    free(rows);
+    return res;
+}
+
+/**
+ *  Shrinks the conflict of a certificate until every one of its rows is
+ *  needed, by solving it again without each of its rows in turn and
+ *  keeping the certificate of any part that still has no solution. These
+ *  solves only see the rows of the conflict, so they are cheap next to the
+ *  one that found it.
+ *
+ *  @param eqns
+ *          The system of equations the certificate is for.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param nEq
+ *          The number of equalities at the front of the system.
+ *  @param budget
+ *          The budget of the solves, may be NULL.
+ *  @param cert
+ *          The certificate, replaced by the smaller ones found.
+ *  @return
+ *          {@code ZMK_UNSAT} once every row of the conflict is needed,
+ *          {@code ZMK_BUDGET} if the budget ran out first or
+ *          {@code ZMK_UNKNOWN} if memory ran out, the certificate staying
+ *          valid in all cases.
+ */
+INT_T farkasMinimize(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, ROW_T nEq,
+        zmk_budget_t* budget, zmk_farkas_t* cert)
+{
+    ROW_T m = cert->nConflict;
+    ROW_T* order = (ROW_T*) malloc(sizeof(ROW_T) * 2 * (m + 1));
+    ROW_T* index = order + m + 1;
+    EQN_T*** sub = (EQN_T***) malloc(sizeof(EQN_T**) * (m + 1));
+    zmk_farkas_t trial;
+    INT_T res = ZMK_UNSAT;
+    ROW_T nSub;
+    ROW_T subEq;
+    ROW_T t;
+    ROW_T c;
+
+    if (order == NULL || sub == NULL || cert->nEqn != nEqn)
+    {
+        free(order);
+        free(sub);
+        return ZMK_UNKNOWN;
+    }
+    memcpy(order, cert->conflict, sizeof(ROW_T) * m);
+
+    for (t = 0; t < m && res == ZMK_UNSAT; ++t)
+    {
+        if (!cert->y[order[t]])
+        {
+            continue;
+        }
+
+        /* The conflict without the row, equalities still in front. */
+        nSub = subEq = 0;
+        for (c = 0; c < cert->nConflict; ++c)
+        {
+            if (cert->conflict[c] != order[t])
+            {
+                index[nSub] = cert->conflict[c];
+                subEq += cert->conflict[c] < nEq;
+                sub[nSub++] = eqns[cert->conflict[c]];
+            }
+        }
+
+        switch (zmkFarkas(sub, nSub, nVar, subEq, budget, &trial))
+        {
+        case ZMK_UNSAT:
+            for (c = 0; c < cert->nConflict; ++c)
+            {
+                cert->y[cert->conflict[c]] = 0;
+            }
+            for (c = 0; c < trial.nConflict; ++c)
+            {
+                cert->conflict[c] = index[trial.conflict[c]];
+                cert->y[cert->conflict[c]] = trial.y[trial.conflict[c]];
+            }
+            cert->nConflict = trial.nConflict;
+            freeFarkas(&trial);
+            break;
+        case ZMK_BUDGET:
+            res = ZMK_BUDGET;
+            break;
+        }
+    }
+    free(order);
+    free(sub);
+    return res;
+}
+
+/**
+ *  Checks a certificate against its system, in time linear in the number
+ *  of coefficients of the rows of its conflict.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param nEq
+ *          The number of equalities at the front of the system.
+ *  @param cert
+ *          The certificate.
+ *  @return
+ *          Non-zero if the certificate proves that the system has no
+ *          solution, zero if it does not or a value overflowed.
+ */
+short farkasCheck(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, ROW_T nEq,
+        const zmk_farkas_t* cert)
+{
+    FARKAS_T* sum = (FARKAS_T*) calloc(2 * (nVar + 1), sizeof(FARKAS_T));
+    FARKAS_T* row = sum + nVar + 1;
+    FARKAS_T x;
+    FARKAS_T y;
+    short ok = sum != NULL && cert->nEqn == nEqn && cert->nConflict > 0;
+    INT_T j;
+    ROW_T c;
+    ROW_T i;
+
+    for (c = 0; ok && c < cert->nConflict; ++c)
+    {
+        i = cert->conflict[c];
+        y = cert->y[i];
+        ok = i < nEqn && y && (y > 0 || i < nEq)
+            && integerEquation(eqns[i], nVar, row);
+        for (j = 0; ok && j <= nVar; ++j)
+        {
+            ok = !__builtin_mul_overflow(y, row[j], &x)
+                && !__builtin_add_overflow(sum[j], x, &sum[j]);
+        }
+    }
+    for (j = 0; ok && j < nVar; ++j)
+    {
+        ok = !sum[j];
+    }
+    ok = ok && sum[nVar] > 0;
+    free(sum);
+    return ok;
+}
+
+/**
+ *  Decides the system in the files A and c and, if it has no solution,
+ *  explains why. The answer is followed by the rows of a smallest conflict,
+ *  each with its multiplier in the certificate, and whether the
+ *  certificate checked. Rows are numbered as {@code parseSystemEq} orders
+ *  them, equalities first, and printed as in the files.
+ *
+ *  @param aname
+ *          The file with the coefficients.
+ *  @param cname
+ *          The file with the constants.
+ *  @param out
+ *          Where to write the explanation.
+ *  @return
+ *          What {@code zmkFarkas} returned, or -3 if a file could not be
+ *          opened or holds a value that does not fit a coefficient.
+ */
+int zmkExplain(const char* aname, const char* cname, FILE* out)
+{
+    FILE* afile = fopen(aname, "r");
+    FILE* cfile = fopen(cname, "r");
+    zmk_farkas_t cert;
+    zmk_budget_t budget;
+    short limited = budgetFromEnv(&budget);
+    EQN_T*** eqns;
+    ROW_T nEqn;
+    INT_T nVar;
+    ROW_T nEq;
+    INT_T res;
+    INT_T j;
+    ROW_T c;
+    ROW_T i;
+
+    if (afile == NULL || cfile == NULL)
+    {
+        fprintf(stderr, "could not open %s\n", afile == NULL ? aname : cname);
+        if (afile != NULL)
+            fclose(afile);
+        if (cfile != NULL)
+            fclose(cfile);
+        return -3;
+    }
+    eqns = parseSystemEq(afile, cfile, &nEqn, &nVar, &nEq);
+    fclose(afile);
+    fclose(cfile);
+    if (eqns == NULL)
+    {
+        fprintf(stderr, "values in %s or %s do not fit a coefficient\n",
+            aname, cname);
+        return -3;
+    }
+
+    res = zmkFarkas(eqns, nEqn, nVar, nEq, limited ? &budget : NULL, &cert);
+    fprintf(out, "%s\n", res == ZMK_BUDGET ? "budget"
+        : res == ZMK_UNKNOWN ? "unknown" : res ? "1" : "0");
+    if (res == ZMK_UNSAT)
+    {
+        farkasMinimize(eqns, nEqn, nVar, nEq, limited ? &budget : NULL,
+            &cert);
+        fprintf(out, "conflict: %zu of %zu rows, certificate %s\n",
+            cert.nConflict, nEqn,
+            farkasCheck(eqns, nEqn, nVar, nEq, &cert) ? "checked" : "FAILED");
+        for (c = 0; c < cert.nConflict; ++c)
+        {
+            i = cert.conflict[c];
+            fprintf(out, "%zu %lld:", i, cert.y[i]);
+            for (j = 0; j <= nVar; ++j)
+            {
+                if (j == nVar)
+                    fprintf(out, " %s", i < nEq ? "=" : "<=");
+                if (eqns[i][j]->denom != 1)
+                    fprintf(out, " %d/%d", j == nVar ? -eqns[i][j]->nom
+                        : eqns[i][j]->nom, (int) eqns[i][j]->denom);
+                else
+                    fprintf(out, " %d", j == nVar ? -eqns[i][j]->nom
+                        : eqns[i][j]->nom);
+            }
+            fprintf(out, "\n");
+        }
+        freeFarkas(&cert);
+    }
+    freeSystem(eqns, nEqn, nVar + 1);
+    return res;
+}
+
+
+/**
+ *  Projects all variables out of a system once, so that it can then be
+ *  decided against any number of vectors of constants by {@code rhsSolve}.
+ *  <p>
+ *  The elimination is that of {@code zmkFarkas} with all constants zero:
+ *  neither the order it eliminates in nor the rows it drops depend on them.
+ *  The multipliers of every row it ends with are kept, each set once.
+ *  <p>
+ *  The system is left untouched.
+ *
+ *  @param eqns
+ *          The system of equations, as read by {@code parseSystemEq}. Its
+ *          constants are ignored.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param nEq
+ *          The number of equalities at the front of the system.
+ *  @param budget
+ *          The budget of the elimination, may be NULL.
+ *  @param rhs
+ *          Filled in with the projection, to be freed with {@code freeRhs}.
+ *  @return
+ *          {@code ZMK_SAT} once the projection is built, {@code ZMK_UNKNOWN}
+ *          if a value overflowed or memory ran out, or {@code ZMK_BUDGET}.
+ */
+INT_T zmkProject(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, ROW_T nEq,
+        zmk_budget_t* budget, zmk_rhs_t* rhs)
+{
+    FARKAS_T* rows = farkasRows(eqns, nEqn, nVar, nEq, 0);
+    farkas_row_t* sorted = NULL;
+    size_t W = (size_t) nVar + 1 + nEqn;
+    size_t n = nEqn + nEq;
+    size_t m = 0;
+    size_t nnz = 0;
+    size_t i;
+    size_t t;
+    long long a;
+    INT_T res = ZMK_UNKNOWN;
+    ROW_T j;
+
+    memset(rhs, 0, sizeof *rhs);
+    rhs->nEqn = nEqn;
+    if (rows != NULL)
+    {
+        res = farkasProject(&rows, &n, nVar, nEqn, 0, budget);
+    }
+    if (res == ZMK_SAT)
+    {
+        sorted = (farkas_row_t*) malloc(sizeof(farkas_row_t) * (n + 1));
+        res = sorted != NULL ? ZMK_SAT : ZMK_UNKNOWN;
+    }
+    if (res != ZMK_SAT)
+    {
+        free(rows);
+        return res;
+    }
+
+    /* Rows whose multipliers cancel out say nothing, equal rows go once. */
+    for (i = 0; i < n; ++i)
+    {
+        if (farkasSupport(rows + i * W + nVar + 1, nEqn))
+        {
+            sorted[m].y = rows + i * W + nVar + 1;
+            sorted[m++].nEqn = nEqn;
+        }
+    }
+    qsort(sorted, m, sizeof sorted[0], compareFarkasRows);
+    for (i = 0, t = 0; i < m; ++i)
+    {
+        if (!t || compareFarkasRows(sorted + t - 1, sorted + i))
+        {
+            sorted[t++] = sorted[i];
+            nnz += farkasSupport(sorted[i].y, nEqn);
+        }
+    }
+    m = t;
+
+    rhs->start = (size_t*) malloc(sizeof(size_t) * (m + 1));
+    rhs->col = (ROW_T*) malloc(sizeof(ROW_T) * (nnz + 1));
+    rhs->y = (long long*) malloc(sizeof(long long) * (nnz + 1));
+    rhs->weight = (long long*) malloc(sizeof(long long) * (m + 1));
+    if (rhs->start == NULL || rhs->col == NULL || rhs->y == NULL
+            || rhs->weight == NULL)
+    {
+        freeRhs(rhs);
+        res = ZMK_UNKNOWN;
+        m = 0;
+    }
+    for (i = 0, t = 0; i < m; ++i)
+    {
+        rhs->start[i] = t;
+        rhs->weight[i] = 0;
+        for (j = 0; j < nEqn; ++j)
+        {
+            if (!sorted[i].y[j])
+            {
+                continue;
+            }
+            rhs->col[t] = j;
+            rhs->y[t++] = sorted[i].y[j];
+            a = sorted[i].y[j] == LLONG_MIN ? LLONG_MAX
+                : llabs(sorted[i].y[j]);
+            if (__builtin_add_overflow(rhs->weight[i], a, &rhs->weight[i]))
+            {
+                rhs->weight[i] = LLONG_MAX;
+            }
+        }
+    }
+    if (res == ZMK_SAT)
+    {
+        rhs->start[m] = t;
+        rhs->nRows = m;
+    }
+    free(sorted);
+    free(rows);
+    return res;
+}
+
+/**
+ *  Decides a system projected by {@code zmkProject} against vectors of
+ *  constants, at the cost of one multiply-add per multiplier and vector.
+ *  <p>
+ *  The vectors are taken {@code RHS_BATCH} at a time. Each multiplier is
+ *  applied to the whole batch in one loop over the vectors, which the
+ *  compiler vectorizes. Rows whose sums can not overflow for the largest
+ *  constant of the vectors take that loop, the others are summed with
+ *  overflow checks.
+ *
+ *  @param rhs
+ *          The projection.
+ *  @param c
+ *          The constants, {@code c[i * nC + v]} being that of row {@code i}
+ *          in vector {@code v}, rows ordered as in the system.
+ *  @param nC
+ *          The number of vectors.
+ *  @param res
+ *          Set to {@code ZMK_SAT}, {@code ZMK_UNSAT} or {@code ZMK_UNKNOWN}
+ *          if a sum overflowed, one per vector.
+ */
+void rhsSolve(const zmk_rhs_t* rhs, const INT_T* c, size_t nC, INT_T* res)
+{
+    long long sum[RHS_BATCH];
+    long long limit;
+    long long most = 0;
+    long long x;
+    const INT_T* cv;
+    size_t b;
+    size_t nb;
+    size_t r;
+    size_t t;
+    size_t v;
+    int overflow;
+
+    for (t = 0; t < rhs->nEqn * nC; ++t)
+    {
+        most = c[t] > most ? c[t] : -(long long) c[t] > most ? -c[t] : most;
+    }
+    limit = most ? LLONG_MAX / most : LLONG_MAX;
+    for (v = 0; v < nC; ++v)
+    {
+        res[v] = ZMK_SAT;
+    }
+
+    for (b = 0; b < nC; b += RHS_BATCH)
+    {
+        nb = nC - b < RHS_BATCH ? nC - b : RHS_BATCH;
+        for (r = 0; r < rhs->nRows; ++r)
+        {
+            memset(sum, 0, sizeof(long long) * nb);
+            if (rhs->weight[r] <= limit)
+            {
+                for (t = rhs->start[r]; t < rhs->start[r + 1]; ++t)
+                {
+                    cv = c + rhs->col[t] * nC + b;
+                    x = rhs->y[t];
+                    for (v = 0; v < nb; ++v)
+                    {
+                        sum[v] += x * cv[v];
+                    }
+                }
+                for (v = 0; v < nb; ++v)
+                {
+                    if (sum[v] < 0)
+                    {
+                        res[b + v] = ZMK_UNSAT;
+                    }
+                }
+                continue;
+            }
+
+            for (v = 0; v < nb; ++v)
+            {
+                overflow = 0;
+                for (t = rhs->start[r]; t < rhs->start[r + 1]; ++t)
+                {
+                    overflow |= __builtin_mul_overflow(rhs->y[t],
+                        (long long) c[rhs->col[t] * nC + b + v], &x);
+                    overflow |= __builtin_add_overflow(sum[v], x, &sum[v]);
+                }
+                if (!overflow && sum[v] < 0)
+                    res[b + v] = ZMK_UNSAT;
+                else if (overflow && res[b + v] != ZMK_UNSAT)
+                    res[b + v] = ZMK_UNKNOWN;
+            }
+        }
+    }
+}
+
+/**
+ *  Decides the system with the coefficients in the file A against the
+ *  constants in each of the files c, projecting it once with
+ *  {@code zmkProject} and deciding all of them with one call of
+ *  {@code rhsSolve}. Every file c has to mark the same rows as equalities.
+ *  <p>
+ *  One line is written per file c, its name and 1 if the system has a
+ *  solution with those constants, 0 if it has none, "unknown" or "budget"
+ *  if the projection could not be built or "error" if the file could not be
+ *  read, does not match A or holds a value that does not fit a coefficient.
+ *
+ *  @param aname
+ *          The file with the coefficients.
+ *  @param cnames
+ *          The files with the constants.
+ *  @param nC
+ *          The number of files c.
+ *  @param out
+ *          Where to write the answers.
+ *  @return
+ *          What {@code zmkProject} returned, or -3 if a file could not be
+ *          opened or A or the first c holds a value that does not fit a
+ *          coefficient.
+ */
+int zmkMultiRhs(const char* aname, char** cnames, int nC, FILE* out)
+{
+    FILE* afile = fopen(aname, "r");
+    FILE* cfile = nC > 0 ? fopen(cnames[0], "r") : NULL;
+    zmk_budget_t budget;
+    short limited = budgetFromEnv(&budget);
+    zmk_rhs_t rhs;
+    EQN_T*** eqns;
+    INT_T* c = NULL;
+    INT_T* res = NULL;
+    char* isEq = NULL;
+    char* ok = NULL;
+    ROW_T nEqn;
+    INT_T nVar;
+    ROW_T nEq;
+    ROW_T found = RHS_UNSET;
+    INT_T proj;
+    int v;
+
+    if (afile == NULL || cfile == NULL)
+    {
+        fprintf(stderr, "could not open %s\n", afile == NULL ? aname
+            : nC > 0 ? cnames[0] : "c");
+        if (afile != NULL)
+            fclose(afile);
+        if (cfile != NULL)
+            fclose(cfile);
+        return -3;
+    }
+    eqns = parseSystemEq(afile, cfile, &nEqn, &nVar, &nEq);
+    fclose(afile);
+    fclose(cfile);
+    if (eqns == NULL)
+    {
+        fprintf(stderr, "values in %s or %s do not fit a coefficient\n",
+            aname, cnames[0]);
+        return -3;
+    }
+
+    proj = zmkProject(eqns, nEqn, nVar, nEq, limited ? &budget : NULL, &rhs);
+    c = (INT_T*) calloc(nEqn * nC + 1, sizeof(INT_T));
+    res = (INT_T*) malloc(sizeof(INT_T) * nC);
+    isEq = (char*) malloc(nEqn + 1);
+    ok = (char*) malloc(nC);
+    if (c == NULL || res == NULL || isEq == NULL || ok == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for (v = 0; v < nC; ++v)
+    {
+        ok[v] = rhsRead(cnames[v], nEqn, isEq, &found, c + v, nC)
+            && found == nEq;
+    }
+    if (proj == ZMK_SAT)
+    {
+        rhsSolve(&rhs, c, nC, res);
+    }
+    for (v = 0; v < nC; ++v)
+    {
+        fprintf(out, "%s %s\n", cnames[v], !ok[v] ? "error"
+            : proj == ZMK_BUDGET ? "budget"
+            : proj != ZMK_SAT || res[v] == ZMK_UNKNOWN ? "unknown"
+            : res[v] ? "1" : "0");
+    }
+
+    freeRhs(&rhs);
+    freeSystem(eqns, nEqn, nVar + 1);
+    free(c);
+    free(res);
+    free(isEq);
+    free(ok);
+    return proj;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef FARKAS_H
+#define FARKAS_H
+
+#include "budget.h"
+#include "coeff.h"
+#include <stdio.h>
+
+/**
+ *  A Farkas certificate that a system has no solution: multipliers
+ *  {@code y}, one per row of the system with each row scaled to integers by
+ *  {@code integerEquation}, such that the combination of the rows has no
+ *  variables left and a positive constant. Multipliers of inequalities are
+ *  non-negative, those of equalities may have either sign. The rows with a
+ *  non-zero multiplier are the conflict.
+ */
+typedef struct zmk_farkas {
+    ROW_T nEqn;             /* Rows of the system it is for. */
+    long long* y;           /* One multiplier per row. */
+    ROW_T nConflict;        /* Rows with a non-zero multiplier. */
+    ROW_T* conflict;        /* Those rows, in ascending order. */
+} zmk_farkas_t;
+
+/*
+ *  rhsSolve decides vectors of constants RHS_BATCH at a time, so that the
+ *  sums for a batch stay in the L1 cache while each multiplier is applied
+ *  to all of them.
+ */
+#define RHS_BATCH       (256)
+
+/**
+ *  A system with its variables projected out, for deciding it against many
+ *  vectors of constants. Every row is a combination {@code y} of the rows
+ *  of the system whose coefficients cancel, so that the system with the
+ *  constants {@code c}, each row reading {@code a x <= c}, has a solution
+ *  exactly when {@code y c >= 0} for every row. The rows are sparse: row
+ *  {@code r} has the multipliers {@code y[start[r]] .. y[start[r + 1] - 1]}
+ *  of the rows {@code col[start[r]] ..} of the system.
+ */
+typedef struct zmk_rhs {
+    ROW_T nEqn;             /* Rows of the system. */
+    size_t nRows;           /* Rows of the projection. */
+    size_t* start;
+    ROW_T* col;
+    long long* y;
+    long long* weight;      /* The sum of |y| of each row, saturated. */
+} zmk_rhs_t;
+
+INT_T zmkFarkas(EQN_T***, ROW_T, INT_T, ROW_T, zmk_budget_t*, zmk_farkas_t*);
+INT_T farkasMinimize(EQN_T***, ROW_T, INT_T, ROW_T, zmk_budget_t*,
+        zmk_farkas_t*);
+short farkasCheck(EQN_T***, ROW_T, INT_T, ROW_T, const zmk_farkas_t*);
+void freeFarkas(zmk_farkas_t*);
+int zmkExplain(const char*, const char*, FILE*);
+INT_T zmkProject(EQN_T***, ROW_T, INT_T, ROW_T, zmk_budget_t*, zmk_rhs_t*);
+void rhsSolve(const zmk_rhs_t*, const INT_T*, size_t, INT_T*);
+void freeRhs(zmk_rhs_t*);
+int zmkMultiRhs(const char*, char**, int, FILE*);
+
+#endif
@@ -1,29 +1,16 @@
-#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <signal.h>
-#include <unistd.h>
 
 /*
  *  My includes and defines.
  */
 #include "coeff.h"
-
-EQN_T*** parseSystem(FILE*, FILE*, INT_T*, INT_T*);
-INT_T zmkFast(EQN_T***, INT_T, INT_T);
-INT_T zmkFastDebug(EQN_T***, INT_T, INT_T);
-void freeSystem(EQN_T**, INT_T);
-void printSystem(EQN_T**, INT_T, INT_T);
+#include "engine.h"
+#include "probe.h"
+#include "zmk.h"
 
 static unsigned long long   fm_count;
-static volatile bool        proceed = false;
 
-static void done(int unused)
-{
-    proceed = false;
-    unused = unused;
-}
-    
 unsigned long long zmk_fm_fast(char* aname, char* cname, int seconds)
 {
     FILE*       afile = fopen(aname, "r");
@@ -44,36 +31,53 @@ unsigned long long zmk_fm_fast(char* aname, char* cname, int seconds)
     /*
      *  Read A and c files.
      */
-    INT_T nEqn = 0;
+    ROW_T nEqn = 0;
     INT_T nVar = 0;
+    ROW_T nEq = 0;
 
     if (seconds == 0) {
-        /* Just run once for validation. */
-        
-        EQN_T*** eqns = parseSystem(afile, cfile, &nEqn, &nVar);
-        INT_T res = zmkFastDebug(eqns, nEqn, nVar);
+        /* Just run once for validation, within ZMK_BUDGET if it is set. */
+        presolve_stats_t stats;
+        zmk_budget_t budget;
+        short limited = budgetFromEnv(&budget);
+        EQN_T*** eqns = parseSystemEq(afile, cfile, &nEqn, &nVar, &nEq);
+        if (eqns == NULL) {
+            fprintf(stderr, "values in A or c do not fit a coefficient\n");
+            exit(1);
+        }
+        INT_T res = zmkSolveEq(eqns, nEqn, nVar, nEq, &stats,
+            limited ? &budget : NULL);
+
+        printPresolveStats(&stats);
+        if (stats.probed)
+            printProbe();
+        if (res == ZMK_BUDGET)
+            printBudget(&budget);
 
         fclose(afile);
         fclose(cfile);
-        return res;
+        return engineAnswer(res);
     }
 
     /*
-     *  Tell operating system to call function DONE when an ALARM comes.
+     *  Now loop until the time is up...
      */
-    signal(SIGALRM, done);
-    alarm(seconds);
-
-    /*
-     *  Now loop until the alarm comes...
-     */
-    proceed = true;
-    while (proceed) {
-        EQN_T*** eqns = parseSystem(afile, cfile, &nEqn, &nVar);
-        zmkFastDebug(eqns, nEqn, nVar);
+    zmk_budget_t run;
+    budgetStart(&run, seconds, 0, 0);
+    while (budgetElapsed(&run) < seconds) {
+        rewind(afile);
+        rewind(cfile);
+        EQN_T*** eqns = parseSystemEq(afile, cfile, &nEqn, &nVar, &nEq);
+        if (eqns == NULL) {
+            fprintf(stderr, "values in A or c do not fit a coefficient\n");
+            exit(1);
+        }
+        zmkSolveEq(eqns, nEqn, nVar, nEq, NULL, NULL);
         fm_count++;
     }
     fclose(afile);
     fclose(cfile);
     return fm_count;
 }
+
+ZMK_ENGINE(zmk_fm_fast, ENGINE_EXACT | ENGINE_EQUALITIES | ENGINE_BUDGET)
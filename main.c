@@ -13,16 +13,35 @@
  *
  * Edit the makefile to refer to the file name with your function.
  * 
- * By adding multiple functions in different files and the array fm 
- * declared in this file, you can benchmark different versions of your
- * project.
+ * Each function registers itself with ZMK_ENGINE from engine.h at the end
+ * of its file, so that linking its object in adds it to the benchmark.
+ * "fm -l" lists the engines linked in and "fm -e fast,small [seconds]"
+ * benchmarks only those whose names hold one of the parts of the filter.
+ * Every engine first answers every test once, and the answers of the
+ * engines are checked against each other as well as against correct. An
+ * engine registered with ENGINE_FIXED may answer ENGINE_UNDECIDED for a
+ * system that does not fit its buffer, and then sits that test out.
  * 
  * When your function is called with seconds = 0, your function should
  * return 1 if there is a solution and 0 if none exists. Otherwise, your
  * function should return the number of times it solved the system.
  *
  * The array correct contains the correct answers, i.e. the systems in
- * input/0 and input/2 have solutions while the other have no solutions.
+ * input/0, input/2, input/6, input/9 and input/11 have solutions while the
+ * other have no solutions. The system in input/6 has more variables than the
+ * fixed-width kernels handle, input/7 is sparse enough for the sparse row
+ * engine, input/8 is mostly equalities, marked by '=' before their
+ * constants, and input/9 pairs 400 by 400 rows into a level of 160000 for
+ * an engine that does not probe the origin first. input/10 has 15
+ * variables and rows the floating-point filter can not decide, so zmkFast
+ * pairs 320 by 320 of them into a level of more than 100000 rows. input/11
+ * is decided by the probe at the middle of the bounds presolve finds.
+ *
+ * "fm -z A c" decides whether the system in A and c has a solution in
+ * integers rather than rationals, with the Omega test.
+ *
+ * With ZMK_PERF=1 in the environment, every count is followed by what the
+ * hardware counters saw per solve, where the machine has them.
  *
  * Your program should work on both the 64-bit Power machine and any x86
  * machine such as the login machines, e.g. login-11.student.lth.se.
@@ -31,32 +50,42 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*
  *  My includes.
  */
 #include "coeff.h"
+#include "corpus.h"
+#include "daemon.h"
+#include "engine.h"
+#include "farkas.h"
+#include "omega.h"
+#include "perf.h"
 #include "util.h"
-#include "run_fm.c"
-#include "zmk_fm_fast.c"
-
-unsigned long long zmk_fm_fast(char* aname, char* cname, int seconds);
 
-#define ENTRY(id)   { .name = #id, .func = id, }
 #define NAME_WIDTH  (20)
 #define COUNT_WIDTH (20)
 #define SPACE       (4)
 #define WIDTH       (SPACE + NAME_WIDTH + COUNT_WIDTH)
+#define NTEST       (sizeof correct/sizeof correct[0])
+
+static unsigned int correct[] = { 1, 0, 1, 0, 0, 0, 1, 0, 0, 1, 0, 1 };
 
 static struct fm {
-    char*           name;
-    unsigned long long  (*func)(char*, char*, int);
+    const char*     name;
+    zmk_fm_t        func;
+    unsigned        flags;
+    size_t          pass;
+    unsigned long long  answer[NTEST];
     unsigned long long  count;
-} fm[] = { 
-    ENTRY(zmk_fm_fast)
-};
+} fm[ENGINES_MAX];
 
-static unsigned int correct[] = { 1, 0, 1, 0, 0, 0 };
+/* Whether an engine sat a test out, as the system did not fit its buffer. */
+static int sat_out(const struct fm* f, size_t j)
+{
+    return f->answer[j] == ENGINE_UNDECIDED && (f->flags & ENGINE_FIXED);
+}
 
 static int compare_count(const void* ap, const void* bp)
 {
@@ -73,15 +102,53 @@ static int compare_count(const void* ap, const void* bp)
 
 int main(int argc, char** argv)
 {
-    size_t          nfunc;
+    size_t          nfunc = 0;
     size_t          i;
     size_t          j;
     unsigned long long  result;
     char            a[BUFSIZ];
     char            c[BUFSIZ];
-    size_t          pass;
     size_t          ntest;
+    size_t          disagree = 0;
+    const char*     filter = NULL;
     int         seconds = 4;
+    zmk_perf_t      perf;
+
+    /* fm -d [socket] answers systems until stdin or the socket closes. */
+    if (argc > 1 && strcmp(argv[1], "-d") == 0)
+        return zmkServe(argc > 2 ? argv[2] : NULL);
+
+    /* fm -f A c explains why a system has no solution. */
+    if (argc > 3 && strcmp(argv[1], "-f") == 0)
+        return zmkExplain(argv[2], argv[3], stdout) < -2;
+
+    /* fm -z A c decides whether a system has a solution in integers. */
+    if (argc > 3 && strcmp(argv[1], "-z") == 0)
+        return zmkInteger(argv[2], argv[3], stdout) < -2;
+
+    /* fm -r A c... decides one matrix against many vectors of constants. */
+    if (argc > 3 && strcmp(argv[1], "-r") == 0)
+        return zmkMultiRhs(argv[2], argv + 3, argc - 3, stdout) < -2;
+
+    /* fm -c dir [readers [solvers]] answers every system of a corpus. */
+    if (argc > 2 && strcmp(argv[1], "-c") == 0) {
+        zmkCorpus(argv[2], argc > 3 ? atoi(argv[3]) : 1,
+            argc > 4 ? atoi(argv[4]) : 0, stdout);
+        return 0;
+    }
+
+    /* fm -l lists the engines linked in. */
+    if (argc > 1 && strcmp(argv[1], "-l") == 0) {
+        printEngines();
+        return 0;
+    }
+
+    /* fm -e filter [seconds] benchmarks the engines passing the filter. */
+    if (argc > 2 && strcmp(argv[1], "-e") == 0) {
+        filter = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
 
     if (argc > 1 
         && sscanf(argv[1], "%d", &seconds) == 1
@@ -90,21 +157,38 @@ int main(int argc, char** argv)
         exit(1);
     }
 
-    ntest = sizeof correct/sizeof correct[0];
-    nfunc = sizeof fm/sizeof fm[0];
+    for (i = 0; i < engineCount(); ++i) {
+        if (engineMatch(engineAt(i), filter)) {
+            fm[nfunc].name = engineAt(i)->name;
+            fm[nfunc].func = engineAt(i)->func;
+            fm[nfunc].flags = engineAt(i)->flags;
+            nfunc++;
+        }
+    }
 
-    for (i = 0; i < nfunc; ++i) {
-        pass = 0;
+    if (nfunc == 0) {
+        fprintf(stderr, "no engine matches %s\n", filter);
+        exit(1);
+    }
 
+    perfFromEnv(&perf);
+    ntest = NTEST;
+
+    for (i = 0; i < nfunc; ++i) {
         for (j = 0; j < ntest; ++j) {
 
             snprintf(a, sizeof a, "input/%zu/A", j);
             snprintf(c, sizeof c, "input/%zu/c", j);
 
             result = (*fm[i].func)(a, c, 0);
+            fm[i].answer[j] = result;
 
-            if (result == correct[j])
-                pass += 1;
+            if (sat_out(&fm[i], j)) {
+                printf("\"%s\" sat out test %zu: "
+                    "the system does not fit.\n", fm[i].name, j);
+                fm[i].pass += 1;
+            } else if (result == correct[j])
+                fm[i].pass += 1;
             else {
                 printf("\"%s\" failed test %zu: "
                     "return value %llu but "
@@ -115,24 +199,53 @@ int main(int argc, char** argv)
 
         }
 
-        if (pass < ntest)
+        if (fm[i].pass < ntest)
             printf("\"%s\" FAILED %zu/%zu TESTS.\n", fm[i].name,
-                ntest - pass, ntest);
-
-        else {
+                ntest - fm[i].pass, ntest);
+        else
             printf("\"%s\" PASSED ALL %zu TESTS.\n", 
                 fm[i].name, ntest);
+    }
 
-            for (j = 0; j < ntest; ++j) {
-                printf("Counting test %zu: ", j);
-                fflush(stdout);
-                snprintf(a, sizeof a, "input/%zu/A", j);
-                snprintf(c, sizeof c, "input/%zu/c", j);
+    /* Engines are checked against each other, not only against correct. */
+    for (j = 0; j < ntest; ++j) {
+        for (i = 1; i < nfunc; ++i) {
+            if (sat_out(&fm[0], j) || sat_out(&fm[i], j))
+                continue;
+            if (fm[i].answer[j] != fm[0].answer[j]) {
+                printf("\"%s\" and \"%s\" disagree on test %zu: "
+                    "%llu against %llu.\n", fm[0].name, fm[i].name, j,
+                    fm[0].answer[j], fm[i].answer[j]);
+                disagree++;
+            }
+        }
+    }
+
+    if (nfunc > 1 && !disagree)
+        printf("ALL %zu ENGINES AGREE ON ALL %zu TESTS.\n", nfunc, ntest);
+
+    for (i = 0; i < nfunc; ++i) {
+        if (fm[i].pass < ntest)
+            continue;
 
-                result = (*fm[i].func)(a, c, seconds);
-                printf("%*llu\n", COUNT_WIDTH, result);
-                fm[i].count += result;
+        printf("Counting \"%s\":\n", fm[i].name);
+        for (j = 0; j < ntest; ++j) {
+            printf("Counting test %zu: ", j);
+            if (sat_out(&fm[i], j)) {
+                printf("%*s\n", COUNT_WIDTH, "-");
+                continue;
             }
+            fflush(stdout);
+            snprintf(a, sizeof a, "input/%zu/A", j);
+            snprintf(c, sizeof c, "input/%zu/c", j);
+
+            perfReset(&perf);
+            perfStart(&perf);
+            result = (*fm[i].func)(a, c, seconds);
+            perfStop(&perf);
+            printf("%*llu\n", COUNT_WIDTH, result);
+            printPerf(&perf, result);
+            fm[i].count += result;
         }
     }
 
@@ -152,5 +265,6 @@ int main(int argc, char** argv)
     for (j = 0; j < WIDTH; ++j)
         putchar('=');
     putchar('\n');
-    return 0;
+    perfClose(&perf);
+    return disagree != 0;
 }
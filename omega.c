@@ -0,0 +1,982 @@
+#ifndef OMEGA_C
+#define OMEGA_C
+
+#include "coeff.h"
+#include "farkas.h"
+#include "omega.h"
+#include "presolve.h"
+#include "util.h"
+#include "zmk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ *  zmkOmega decides whether a system has an integer solution with the
+ *  Omega test. Its rows are integers of width nVar + 1, the coefficients
+ *  and then the constant, the first nEq of them reading a x + k = 0 and
+ *  the others a x + k <= 0. Equalities add columns as they are solved, a
+ *  variable that is gone keeps its column of zeros.
+ */
+#define OMEGA_T         long long
+
+typedef struct omega_sys {
+    OMEGA_T* a;
+    size_t nRow;
+    size_t nEq;
+    size_t nVar;
+} omega_sys_t;
+
+/*
+ *  A row of a system with its number of variables, for sorting rows so
+ *  that parallel ones come together.
+ */
+typedef struct omega_row {
+    const OMEGA_T* row;
+    size_t nVar;
+} omega_row_t;
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Returns {@code a / b} rounded down, for a positive {@code b}.
+ */
+static OMEGA_T floorDiv(OMEGA_T a, OMEGA_T b)
+{
+    OMEGA_T q = a / b;
+
+    return (a % b) && a < 0 ? q - 1 : q;
+}
+
+/**
+ *  Returns {@code a} modulo {@code m} in {@code [-m / 2, m / 2)}, Pugh's
+ *  symmetric remainder.
+ */
+static OMEGA_T modHat(OMEGA_T a, OMEGA_T m)
+{
+    OMEGA_T r = a - m * floorDiv(a, m);
+
+    return 2 * r < m ? r : r - m;
+}
+
+/**
+ *  Orders rows by their coefficients and, among parallel rows, the
+ *  tightest, the one with the largest constant, first.
+ */
+static int compareOmegaRows(const void* ap, const void* bp)
+{
+    const omega_row_t* a = (const omega_row_t*) ap;
+    const omega_row_t* b = (const omega_row_t*) bp;
+    size_t j;
+
+    for (j = 0; j < a->nVar; ++j)
+    {
+        if (a->row[j] != b->row[j])
+        {
+            return a->row[j] < b->row[j] ? -1 : 1;
+        }
+    }
+    return a->row[a->nVar] > b->row[a->nVar] ? -1
+        : a->row[a->nVar] < b->row[a->nVar];
+}
+
+/* ========= *
+ *  Object.  *
+ * ========= */
+
+/**
+ *  Allocates a system of {@code nRow} rows over {@code nVar} variables.
+ *
+ *  @return
+ *          Zero if memory ran out.
+ */
+static short omegaAlloc(omega_sys_t* s, size_t nRow, size_t nVar)
+{
+    s->nRow = nRow;
+    s->nEq = 0;
+    s->nVar = nVar;
+    s->a = (OMEGA_T*) malloc(sizeof(OMEGA_T) * (nRow + 1) * (nVar + 1));
+    return s->a != NULL;
+}
+
+static void omegaFree(omega_sys_t* s)
+{
+    free(s->a);
+    s->a = NULL;
+}
+
+/**
+ *  Builds the rows of a system as read by {@code parseSystemEq}, each scaled
+ *  to integers by {@code integerEquation}.
+ *
+ *  @return
+ *          Zero if a row does not fit or memory ran out.
+ */
+static short omegaRows(omega_sys_t* s, EQN_T*** eqns, ROW_T nEqn,
+        INT_T nVar, ROW_T nEq)
+{
+    ROW_T i;
+
+    if (!omegaAlloc(s, nEqn, nVar))
+    {
+        return 0;
+    }
+    s->nEq = nEq;
+    for (i = 0; i < nEqn; ++i)
+    {
+        if (!integerEquation(eqns[i], nVar, s->a + i * (nVar + 1)))
+        {
+            omegaFree(s);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ *  Copies a system, with room for {@code extra} rows at the front that the
+ *  caller fills in.
+ *
+ *  @return
+ *          Zero if memory ran out.
+ */
+static short omegaCopy(omega_sys_t* out, const omega_sys_t* s, size_t extra)
+{
+    size_t W = s->nVar + 1;
+
+    if (!omegaAlloc(out, s->nRow + extra, s->nVar))
+    {
+        return 0;
+    }
+    out->nEq = s->nEq;
+    memcpy(out->a + extra * W, s->a, sizeof(OMEGA_T) * s->nRow * W);
+    return 1;
+}
+
+/**
+ *  Adds a column of zeros in front of the constants.
+ *
+ *  @return
+ *          Zero if memory ran out.
+ */
+static short omegaAddColumn(omega_sys_t* s)
+{
+    size_t W = s->nVar + 1;
+    OMEGA_T* a = (OMEGA_T*) malloc(sizeof(OMEGA_T) * (s->nRow + 1) * (W + 1));
+    size_t i;
+
+    if (a == NULL)
+    {
+        return 0;
+    }
+    for (i = 0; i < s->nRow; ++i)
+    {
+        memcpy(a + i * (W + 1), s->a + i * W, sizeof(OMEGA_T) * s->nVar);
+        a[i * (W + 1) + s->nVar] = 0;
+        a[i * (W + 1) + W] = s->a[i * W + s->nVar];
+    }
+    free(s->a);
+    s->a = a;
+    s->nVar++;
+    return 1;
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Keeps only the tightest of each set of parallel inequalities, which
+ *  after {@code omegaNormalize} have the same coefficients. Without this
+ *  the shadow of a variable would pair every bound with every other one
+ *  again. The system is left as it is if memory runs out.
+ */
+static void omegaParallel(omega_sys_t* s)
+{
+    size_t W = s->nVar + 1;
+    size_t nIneq = s->nRow - s->nEq;
+    omega_row_t* rows = (omega_row_t*) malloc(sizeof(omega_row_t)
+        * (nIneq + 1));
+    OMEGA_T* a = (OMEGA_T*) malloc(sizeof(OMEGA_T) * (s->nRow + 1) * W);
+    size_t n = s->nEq;
+    size_t i;
+
+    if (rows == NULL || a == NULL || nIneq < 2)
+    {
+        free(rows);
+        free(a);
+        return;
+    }
+    for (i = 0; i < nIneq; ++i)
+    {
+        rows[i].row = s->a + (s->nEq + i) * W;
+        rows[i].nVar = s->nVar;
+    }
+    qsort(rows, nIneq, sizeof rows[0], compareOmegaRows);
+
+    memcpy(a, s->a, sizeof(OMEGA_T) * s->nEq * W);
+    for (i = 0; i < nIneq; ++i)
+    {
+        if (i && !memcmp(rows[i].row, rows[i - 1].row,
+                sizeof(OMEGA_T) * s->nVar))
+        {
+            continue;
+        }
+        memcpy(a + n++ * W, rows[i].row, sizeof(OMEGA_T) * W);
+    }
+    free(rows);
+    free(s->a);
+    s->a = a;
+    s->nRow = n;
+}
+
+/**
+ *  Divides every row by the gcd of its coefficients. The constant of an
+ *  inequality is rounded up, which tightens it to the integers, that of an
+ *  equality has to be divisible. Rows without variables are checked and
+ *  dropped, the equalities stay in front, and of parallel inequalities
+ *  only the tightest is kept.
+ *
+ *  @return
+ *          Non-zero if a row can not hold for any integers.
+ */
+static short omegaNormalize(omega_sys_t* s)
+{
+    size_t W = s->nVar + 1;
+    size_t n = 0;
+    size_t nEq = 0;
+    size_t i;
+    size_t j;
+    OMEGA_T* row;
+    OMEGA_T g;
+
+    for (i = 0; i < s->nRow; ++i)
+    {
+        row = s->a + i * W;
+        for (j = 0, g = 0; j < s->nVar; ++j)
+        {
+            g = gcdLong(g, row[j]);
+        }
+        if (!g)
+        {
+            if (i < s->nEq ? row[s->nVar] != 0 : row[s->nVar] > 0)
+            {
+                return 1;
+            }
+            continue;
+        }
+        if (i < s->nEq)
+        {
+            if (row[s->nVar] % g)
+            {
+                return 1;
+            }
+            row[s->nVar] /= g;
+        }
+        else
+        {
+            row[s->nVar] = -floorDiv(-row[s->nVar], g);
+        }
+        for (j = 0; g > 1 && j < s->nVar; ++j)
+        {
+            row[j] /= g;
+        }
+        if (n != i)
+        {
+            memcpy(s->a + n * W, row, sizeof(OMEGA_T) * W);
+        }
+        nEq += i < s->nEq;
+        ++n;
+    }
+    s->nRow = n;
+    s->nEq = nEq;
+    omegaParallel(s);
+    return 0;
+}
+
+/**
+ *  Replaces variable {@code k} by {@code expr}, a row of the same width
+ *  whose column {@code k} is zero, in every row.
+ *
+ *  @return
+ *          Non-zero if a value overflowed.
+ */
+static int omegaSubstitute(omega_sys_t* s, size_t k, const OMEGA_T* expr)
+{
+    size_t W = s->nVar + 1;
+    int overflow = 0;
+    OMEGA_T* row;
+    OMEGA_T t;
+    OMEGA_T x;
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < s->nRow; ++i)
+    {
+        row = s->a + i * W;
+        if (!(t = row[k]))
+        {
+            continue;
+        }
+        for (j = 0; j < W; ++j)
+        {
+            overflow |= __builtin_mul_overflow(t, expr[j], &x);
+            overflow |= __builtin_add_overflow(row[j], x, &row[j]);
+        }
+        row[k] = 0;
+    }
+    return overflow;
+}
+
+/**
+ *  Takes a step towards solving the first equality. If it has a
+ *  coefficient of one, the equality is solved for that variable, which is
+ *  substituted away. Otherwise Pugh's new variable {@code sigma} with
+ *  {@code m = |a_k| + 1} for the smallest coefficient {@code a_k} is
+ *  introduced: {@code m sigma} is the sum of the coefficients and the
+ *  constant taken {@code modHat m}, in which {@code x_k} has the
+ *  coefficient {@code -sign(a_k)}, so {@code x_k} is substituted away
+ *  again and the coefficients of the equality get smaller.
+ *
+ *  @return
+ *          Zero or {@code ZMK_UNKNOWN} if a value overflowed or memory ran
+ *          out.
+ */
+static int omegaEquality(omega_sys_t* s, omega_stats_t* stats)
+{
+    OMEGA_T* row = s->a;
+    OMEGA_T* expr;
+    OMEGA_T sign;
+    OMEGA_T m;
+    size_t nVar = s->nVar;
+    size_t k = nVar;
+    size_t j;
+    int res;
+
+    for (j = 0; j < nVar; ++j)
+    {
+        if (row[j] && (k == nVar || llabs(row[j]) < llabs(row[k])))
+        {
+            k = j;
+        }
+    }
+    sign = row[k] > 0 ? 1 : -1;
+    m = llabs(row[k]) + 1;
+
+    expr = (OMEGA_T*) calloc(nVar + 2, sizeof(OMEGA_T));
+    if (expr == NULL)
+    {
+        return ZMK_UNKNOWN;
+    }
+    if (m == 2)
+    {
+        stats->nUnit++;
+        for (j = 0; j <= nVar; ++j)
+        {
+            expr[j] = -sign * row[j];
+        }
+    }
+    else
+    {
+        stats->nModHat++;
+        for (j = 0; j <= nVar; ++j)
+        {
+            expr[j + (j == nVar)] = sign * modHat(row[j], m);
+        }
+        expr[nVar] = -sign * m;
+        if (!omegaAddColumn(s))
+        {
+            free(expr);
+            return ZMK_UNKNOWN;
+        }
+    }
+    expr[k] = 0;
+    res = omegaSubstitute(s, k, expr) ? ZMK_UNKNOWN : 0;
+    free(expr);
+    return res;
+}
+
+/**
+ *  Chooses the variable to eliminate next. A variable with coefficients of
+ *  one sign only is taken first, then one whose elimination is exact, all
+ *  of its upper or all of its lower bounds having a unit coefficient, and
+ *  among those the one adding the fewest rows.
+ *
+ *  @param exact
+ *          Set if the real shadow of the variable is exact.
+ *  @param oneSided
+ *          Set if the variable has coefficients of one sign only.
+ *  @return
+ *          The column of the variable, {@code s->nVar} if no row has any.
+ */
+static size_t omegaChoose(const omega_sys_t* s, short* exact,
+        short* oneSided)
+{
+    size_t W = s->nVar + 1;
+    size_t best = s->nVar;
+    double bestGrowth = 0;
+    double growth;
+    size_t nUp;
+    size_t nLo;
+    short unitUp;
+    short unitLo;
+    size_t i;
+    size_t j;
+    OMEGA_T a;
+
+    *exact = 0;
+    *oneSided = 0;
+    for (j = 0; j < s->nVar; ++j)
+    {
+        nUp = nLo = 0;
+        unitUp = unitLo = 1;
+        for (i = 0; i < s->nRow; ++i)
+        {
+            a = s->a[i * W + j];
+            if (a > 0)
+            {
+                nUp++;
+                unitUp &= a == 1;
+            }
+            else if (a < 0)
+            {
+                nLo++;
+                unitLo &= a == -1;
+            }
+        }
+        if (!nUp && !nLo)
+        {
+            continue;
+        }
+        if (!nUp || !nLo)
+        {
+            *oneSided = 1;
+            *exact = 1;
+            return j;
+        }
+        growth = (double) nUp * nLo - nUp - nLo;
+        if (best == s->nVar || (unitUp || unitLo) > *exact
+                || ((unitUp || unitLo) == *exact && growth < bestGrowth))
+        {
+            best = j;
+            bestGrowth = growth;
+            *exact = unitUp || unitLo;
+        }
+    }
+    return best;
+}
+
+/**
+ *  Drops every row holding variable {@code k}, which only has coefficients
+ *  of one sign and so can be taken large enough for all of them.
+ */
+static void omegaDrop(omega_sys_t* s, size_t k)
+{
+    size_t W = s->nVar + 1;
+    size_t n = 0;
+    size_t i;
+
+    for (i = 0; i < s->nRow; ++i)
+    {
+        if (s->a[i * W + k])
+        {
+            continue;
+        }
+        if (n != i)
+        {
+            memcpy(s->a + n * W, s->a + i * W, sizeof(OMEGA_T) * W);
+        }
+        ++n;
+    }
+    s->nRow = n;
+}
+
+/**
+ *  Decides a system without equalities whose only variable left is
+ *  {@code k}, from its largest lower bound and its smallest upper bound.
+ *
+ *  @param res
+ *          Set to {@code ZMK_SAT} or {@code ZMK_UNSAT}.
+ *  @return
+ *          Non-zero if {@code k} is the only variable left.
+ */
+static short omegaSingle(const omega_sys_t* s, size_t k, INT_T* res)
+{
+    size_t W = s->nVar + 1;
+    const OMEGA_T* row;
+    OMEGA_T lo = 0;
+    OMEGA_T up = 0;
+    OMEGA_T b;
+    short hasLo = 0;
+    short hasUp = 0;
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < s->nRow; ++i)
+    {
+        row = s->a + i * W;
+        for (j = 0; j < s->nVar; ++j)
+        {
+            if (j != k && row[j])
+            {
+                return 0;
+            }
+        }
+    }
+    for (i = 0; i < s->nRow; ++i)
+    {
+        row = s->a + i * W;
+        if (row[k] > 0)
+        {
+            /* a x_k + u <= 0 reads x_k <= floor(-u / a). */
+            b = floorDiv(-row[s->nVar], row[k]);
+            up = hasUp && up < b ? up : b;
+            hasUp = 1;
+        }
+        else if (row[k] < 0)
+        {
+            /* -b x_k + l <= 0 reads x_k >= ceil(l / b). */
+            b = -floorDiv(-row[s->nVar], -row[k]);
+            lo = hasLo && lo > b ? lo : b;
+            hasLo = 1;
+        }
+    }
+    *res = !hasLo || !hasUp || lo <= up ? ZMK_SAT : ZMK_UNSAT;
+    return 1;
+}
+
+/**
+ *  Eliminates variable {@code k} from a system without equalities. Every
+ *  upper bound {@code a x_k + u <= 0} is combined with every lower bound
+ *  {@code -b x_k + l <= 0} into {@code b u + a l <= 0}, the real shadow.
+ *  The dark shadow asks for {@code (a - 1)(b - 1)} more room between the
+ *  bounds, so that an integer {@code x_k} fits in between.
+ *
+ *  @param out
+ *          Set to the shadow.
+ *  @param dark
+ *          Non-zero for the dark shadow.
+ *  @return
+ *          Zero, {@code ZMK_UNKNOWN} if a value overflowed or memory ran out
+ *          or {@code ZMK_BUDGET} if the budget ran out.
+ */
+static int omegaShadow(omega_sys_t* out, const omega_sys_t* s, size_t k,
+        short dark, zmk_budget_t* budget)
+{
+    size_t W = s->nVar + 1;
+    size_t nUp = 0;
+    size_t nLo = 0;
+    size_t n = 0;
+    size_t size;
+    size_t i;
+    size_t l;
+    size_t j;
+    const OMEGA_T* up;
+    const OMEGA_T* lo;
+    OMEGA_T* row;
+    OMEGA_T a;
+    OMEGA_T b;
+    OMEGA_T x;
+    OMEGA_T y;
+    int overflow = 0;
+
+    for (i = 0; i < s->nRow; ++i)
+    {
+        nUp += s->a[i * W + k] > 0;
+        nLo += s->a[i * W + k] < 0;
+    }
+    if (nLo && nUp > ((size_t) -1 / sizeof(OMEGA_T) / W - s->nRow) / nLo)
+    {
+        return ZMK_UNKNOWN;
+    }
+    size = s->nRow - nUp - nLo + nUp * nLo;
+    if (budgetLevel(budget, nUp * nLo, size * W * sizeof(OMEGA_T)))
+    {
+        return ZMK_BUDGET;
+    }
+    if (!omegaAlloc(out, size, s->nVar))
+    {
+        return ZMK_UNKNOWN;
+    }
+
+    for (i = 0; i < s->nRow; ++i)
+    {
+        if (!s->a[i * W + k])
+        {
+            memcpy(out->a + n++ * W, s->a + i * W, sizeof(OMEGA_T) * W);
+        }
+    }
+    for (i = 0; i < s->nRow; ++i)
+    {
+        up = s->a + i * W;
+        if ((a = up[k]) <= 0)
+        {
+            continue;
+        }
+        if (budgetCheck(budget))
+        {
+            omegaFree(out);
+            return ZMK_BUDGET;
+        }
+        for (l = 0; l < s->nRow; ++l)
+        {
+            lo = s->a + l * W;
+            if ((b = -lo[k]) <= 0)
+            {
+                continue;
+            }
+            row = out->a + n++ * W;
+            for (j = 0; j < W; ++j)
+            {
+                overflow |= __builtin_mul_overflow(b, up[j], &x);
+                overflow |= __builtin_mul_overflow(a, lo[j], &y);
+                overflow |= __builtin_add_overflow(x, y, &row[j]);
+            }
+            if (dark)
+            {
+                overflow |= __builtin_mul_overflow(a - 1, b - 1, &x);
+                overflow |= __builtin_add_overflow(row[s->nVar], x,
+                    &row[s->nVar]);
+            }
+        }
+    }
+    if (overflow)
+    {
+        omegaFree(out);
+        return ZMK_UNKNOWN;
+    }
+    return 0;
+}
+
+static INT_T omegaSolve(omega_sys_t*, zmk_budget_t*, omega_stats_t*);
+
+/**
+ *  Searches the splinters of variable {@code k}, for when its real shadow
+ *  has an integer solution and its dark shadow has none. With {@code A}
+ *  the largest coefficient of its upper bounds, an integer solution of the
+ *  system then has {@code b x_k = l + i} for some lower bound
+ *  {@code -b x_k + l <= 0} and some {@code 0 <= i <= (A b - A - b) / A}.
+ *  Each of those equalities is added to the system in turn.
+ *
+ *  @return
+ *          The result of the first splinter that is not {@code ZMK_UNSAT},
+ *          {@code ZMK_UNSAT} if there is none.
+ */
+static INT_T omegaSplinter(const omega_sys_t* s, size_t k,
+        zmk_budget_t* budget, omega_stats_t* stats)
+{
+    size_t W = s->nVar + 1;
+    omega_sys_t t;
+    OMEGA_T A = 0;
+    OMEGA_T b;
+    OMEGA_T last;
+    OMEGA_T i;
+    size_t l;
+    INT_T res;
+
+    for (l = 0; l < s->nRow; ++l)
+    {
+        A = s->a[l * W + k] > A ? s->a[l * W + k] : A;
+    }
+    for (l = 0; l < s->nRow; ++l)
+    {
+        if ((b = -s->a[l * W + k]) <= 0)
+        {
+            continue;
+        }
+        if (__builtin_mul_overflow(A, b, &last))
+        {
+            return ZMK_UNKNOWN;
+        }
+        last = (last - A - b) / A;
+        for (i = 0; i <= last; ++i)
+        {
+            if (!omegaCopy(&t, s, 1))
+            {
+                return ZMK_UNKNOWN;
+            }
+            memcpy(t.a, s->a + l * W, sizeof(OMEGA_T) * W);
+            t.a[s->nVar] += i;
+            t.nEq = 1;
+            stats->nSplinter++;
+            res = omegaSolve(&t, budget, stats);
+            if (res != ZMK_UNSAT)
+            {
+                return res;
+            }
+        }
+    }
+    return ZMK_UNSAT;
+}
+
+/**
+ *  Decides whether a system has an integer solution, freeing it.
+ *  <p>
+ *  Equalities are solved first by {@code omegaEquality}, then one variable
+ *  after the other is eliminated. Where the elimination is exact the real
+ *  shadow is the answer, as plain Fourier-Motzkin would give it. Otherwise
+ *  a real shadow without an integer solution means the system has none, a
+ *  dark shadow with one means the system has one, and only when the two
+ *  disagree are the splinters searched.
+ *
+ *  @return
+ *          {@code ZMK_SAT} or {@code ZMK_UNSAT}, {@code ZMK_UNKNOWN} if a
+ *          value overflowed or memory ran out or {@code ZMK_BUDGET} if the
+ *          budget ran out.
+ */
+static INT_T omegaSolve(omega_sys_t* s, zmk_budget_t* budget,
+        omega_stats_t* stats)
+{
+    omega_sys_t shadow;
+    short exact;
+    short oneSided;
+    size_t k;
+    INT_T res;
+
+    for (;;)
+    {
+        if (budgetCheck(budget))
+        {
+            res = ZMK_BUDGET;
+            break;
+        }
+        if (omegaNormalize(s))
+        {
+            res = ZMK_UNSAT;
+            break;
+        }
+        if (s->nEq)
+        {
+            if ((res = omegaEquality(s, stats)))
+            {
+                break;
+            }
+            continue;
+        }
+
+        k = omegaChoose(s, &exact, &oneSided);
+        if (k == s->nVar)
+        {
+            res = ZMK_SAT;
+            break;
+        }
+        if (oneSided)
+        {
+            omegaDrop(s, k);
+            continue;
+        }
+        if (omegaSingle(s, k, &res))
+        {
+            break;
+        }
+        if ((res = omegaShadow(&shadow, s, k, 0, budget)))
+        {
+            break;
+        }
+        if (exact)
+        {
+            stats->nExact++;
+            omegaFree(s);
+            *s = shadow;
+            continue;
+        }
+
+        stats->nInexact++;
+        if ((res = omegaSolve(&shadow, budget, stats)) != ZMK_SAT)
+        {
+            break;
+        }
+        if ((res = omegaShadow(&shadow, s, k, 1, budget)))
+        {
+            break;
+        }
+        if ((res = omegaSolve(&shadow, budget, stats)) != ZMK_UNSAT)
+        {
+            stats->nDark += res == ZMK_SAT;
+            break;
+        }
+        res = omegaSplinter(s, k, budget, stats);
+        break;
+    }
+    omegaFree(s);
+    return res;
+}
+
+/**
+ *  Copies a system of equations for the rational filter of
+ *  {@code zmkOmega}, which frees what it is given.
+ *
+ *  @return
+ *          The copy, NULL if memory ran out.
+ */
+static EQN_T*** omegaCopySystem(EQN_T*** eqns, ROW_T nEqn, INT_T nVar)
+{
+    EQN_T*** copy = (EQN_T***) malloc(sizeof(EQN_T**) * (nEqn + 1));
+    ROW_T i;
+    INT_T j;
+
+    for (i = 0; i < nEqn && copy != NULL; ++i)
+    {
+        copy[i] = (EQN_T**) malloc(sizeof(EQN_T*) * (nVar + 1));
+        if (copy[i] == NULL)
+        {
+            freeSystem(copy, i, nVar + 1);
+            return NULL;
+        }
+        for (j = 0; j <= nVar; ++j)
+        {
+            copy[i][j] = copyCoeff(eqns[i][j]);
+        }
+    }
+    return copy;
+}
+
+/**
+ *  Decides whether a system as read by {@code parseSystemEq} has a solution
+ *  in integers. A copy of the system is first decided over the rationals by
+ *  {@code zmkSolveEq}. If one of its probes satisfied the system, that
+ *  point is an integer solution. If it finds no rational solution and
+ *  {@code zmkFarkas} gives a certificate for that which {@code farkasCheck}
+ *  accepts, there is no integer one either. Any other answer is left to the
+ *  Omega test. The system is freed in all cases.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param nEq
+ *          The number of equalities at the front of the system.
+ *  @param budget
+ *          The budget of the solve, already started, may be NULL.
+ *  @param stats
+ *          Filled in with how the system was decided, may be NULL.
+ *  @return
+ *          Zero if there is no integer solution, {@code ZMK_UNKNOWN} if a
+ *          value overflowed or memory ran out, {@code ZMK_BUDGET} if the
+ *          budget ran out and a positive integer otherwise.
+ */
+INT_T zmkOmega(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, ROW_T nEq,
+        zmk_budget_t* budget, omega_stats_t* stats)
+{
+    omega_stats_t local;
+    presolve_stats_t presolve;
+    omega_sys_t s;
+    zmk_farkas_t cert;
+    EQN_T*** copy = omegaCopySystem(eqns, nEqn, nVar);
+    short ok;
+    INT_T res = ZMK_UNKNOWN;
+
+    if (stats == NULL)
+    {
+        stats = &local;
+    }
+    memset(stats, 0, sizeof *stats);
+    if (copy != NULL)
+    {
+        res = zmkSolveEq(copy, nEqn, nVar, nEq, &presolve, budget);
+        if (res == ZMK_SAT && presolve.probed)
+        {
+            freeSystem(eqns, nEqn, nVar + 1);
+            return ZMK_SAT;
+        }
+    }
+    if (res == ZMK_UNSAT)
+    {
+        res = zmkFarkas(eqns, nEqn, nVar, nEq, budget, &cert);
+        if (res == ZMK_UNSAT)
+        {
+            if (!farkasCheck(eqns, nEqn, nVar, nEq, &cert))
+            {
+                res = ZMK_UNKNOWN;
+            }
+            freeFarkas(&cert);
+        }
+    }
+
+    ok = omegaRows(&s, eqns, nEqn, nVar, nEq);
+    freeSystem(eqns, nEqn, nVar + 1);
+    if (res == ZMK_UNSAT || res == ZMK_BUDGET || !ok)
+    {
+        stats->rational = res == ZMK_UNSAT;
+        if (ok)
+        {
+            omegaFree(&s);
+        }
+        return res == ZMK_UNSAT || res == ZMK_BUDGET ? res : ZMK_UNKNOWN;
+    }
+    return omegaSolve(&s, budget, stats);
+}
+
+/**
+ *  Writes how a system was decided by {@code zmkOmega} on a single line.
+ */
+void printOmegaStats(FILE* out, omega_stats_t* stats)
+{
+    fprintf(out, "omega: %s, %zu unit and %zu mod-hat equalities, "
+        "%zu exact and %zu inexact eliminations, %zu by the dark shadow, "
+        "%zu splinters\n",
+        stats->rational ? "no rational solution" : "decided by the Omega test",
+        stats->nUnit, stats->nModHat, stats->nExact, stats->nInexact,
+        stats->nDark, stats->nSplinter);
+}
+
+/**
+ *  Decides whether the system in the files A and c has an integer solution
+ *  and tells how.
+ *
+ *  @param aname
+ *          The file with the coefficients.
+ *  @param cname
+ *          The file with the constants.
+ *  @param out
+ *          Where to write the answer.
+ *  @return
+ *          What {@code zmkOmega} returned, or -3 if a file could not be
+ *          opened or holds a value that does not fit a coefficient.
+ */
+int zmkInteger(const char* aname, const char* cname, FILE* out)
+{
+    FILE* afile = fopen(aname, "r");
+    FILE* cfile = fopen(cname, "r");
+    omega_stats_t stats;
+    zmk_budget_t budget;
+    short limited = budgetFromEnv(&budget);
+    EQN_T*** eqns;
+    ROW_T nEqn;
+    INT_T nVar;
+    ROW_T nEq;
+    INT_T res;
+
+    if (afile == NULL || cfile == NULL)
+    {
+        fprintf(stderr, "could not open %s\n", afile == NULL ? aname : cname);
+        if (afile != NULL)
+            fclose(afile);
+        if (cfile != NULL)
+            fclose(cfile);
+        return -3;
+    }
+    eqns = parseSystemEq(afile, cfile, &nEqn, &nVar, &nEq);
+    fclose(afile);
+    fclose(cfile);
+    if (eqns == NULL)
+    {
+        fprintf(stderr, "values in %s or %s do not fit a coefficient\n",
+            aname, cname);
+        return -3;
+    }
+
+    res = zmkOmega(eqns, nEqn, nVar, nEq, limited ? &budget : NULL, &stats);
+    fprintf(out, "%s\n", res == ZMK_BUDGET ? "budget"
+        : res == ZMK_UNKNOWN ? "unknown" : res ? "1" : "0");
+    printOmegaStats(out, &stats);
+    if (res == ZMK_BUDGET && limited)
+        printBudget(&budget);
+    return res;
+}
+
+#endif
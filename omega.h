@@ -0,0 +1,25 @@
+#ifndef OMEGA_H
+#define OMEGA_H
+
+#include "budget.h"
+#include "coeff.h"
+#include <stdio.h>
+
+/**
+ *  Counters describing how {@code zmkOmega} decided a system.
+ */
+typedef struct omega_stats {
+    short rational;         /* No rational solution, certified. */
+    size_t nUnit;           /* Equalities solved for a unit coefficient. */
+    size_t nModHat;         /* Equalities reduced by a new variable. */
+    size_t nExact;          /* Variables whose real shadow was exact. */
+    size_t nInexact;        /* Variables that needed the dark shadow. */
+    size_t nDark;           /* Of those, decided by the dark shadow. */
+    size_t nSplinter;       /* Splinters searched. */
+} omega_stats_t;
+
+INT_T zmkOmega(EQN_T***, ROW_T, INT_T, ROW_T, zmk_budget_t*, omega_stats_t*);
+void printOmegaStats(FILE*, omega_stats_t*);
+int zmkInteger(const char*, const char*, FILE*);
+
+#endif
@@ -0,0 +1,268 @@
+#ifndef PERF_C
+#define PERF_C
+
+#define _GNU_SOURCE
+
+#include "perf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char* perfNames[PERF_COUNTERS] = {
+    "cycles", "instructions", "L1d misses", "LLC misses", "branch misses",
+    "page faults",
+};
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+#ifdef __linux__
+/**
+ *  Opens one counter of the calling thread, on any CPU, counting user
+ *  space only so that it is allowed under the default
+ *  {@code perf_event_paranoid}. Threads the calling thread starts later
+ *  inherit the counter, so the worker threads of the portfolio and of
+ *  zmkComponents are counted as well once they are joined.
+ *
+ *  @return
+ *          The file descriptor of the counter, -1 if it is not available.
+ */
+static int perfOpenEvent(unsigned int type, unsigned long long config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+        | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ *  Reads a counter as its value, the time it was enabled and the time it
+ *  was running.
+ */
+static int perfRead(int fd, unsigned long long* out)
+{
+    return read(fd, out, 3 * sizeof *out) == (ssize_t) (3 * sizeof *out);
+}
+#endif
+
+/* ========= *
+ *  Object.  *
+ * ========= */
+
+/**
+ *  Opens the counters of the calling thread and the threads it starts.
+ *
+ *  @param perf
+ *          The counters.
+ *  @return
+ *          The number of counters that could be opened, zero if there are
+ *          none on this system.
+ */
+int perfOpen(zmk_perf_t* perf)
+{
+    int i;
+
+    memset(perf, 0, sizeof *perf);
+    for (i = 0; i < PERF_COUNTERS; ++i)
+    {
+        perf->fd[i] = -1;
+    }
+#ifdef __linux__
+    perf->fd[PERF_CYCLES] = perfOpenEvent(PERF_TYPE_HARDWARE,
+        PERF_COUNT_HW_CPU_CYCLES);
+    perf->fd[PERF_INSTRUCTIONS] = perfOpenEvent(PERF_TYPE_HARDWARE,
+        PERF_COUNT_HW_INSTRUCTIONS);
+    perf->fd[PERF_L1_MISSES] = perfOpenEvent(PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    perf->fd[PERF_LLC_MISSES] = perfOpenEvent(PERF_TYPE_HARDWARE,
+        PERF_COUNT_HW_CACHE_MISSES);
+    perf->fd[PERF_BRANCH_MISSES] = perfOpenEvent(PERF_TYPE_HARDWARE,
+        PERF_COUNT_HW_BRANCH_MISSES);
+    perf->fd[PERF_PAGE_FAULTS] = perfOpenEvent(PERF_TYPE_SOFTWARE,
+        PERF_COUNT_SW_PAGE_FAULTS);
+#endif
+    for (i = 0; i < PERF_COUNTERS; ++i)
+    {
+        perf->nOpen += perf->fd[i] >= 0;
+    }
+    return perf->nOpen;
+}
+
+/**
+ *  Opens the counters if the environment asks for them.
+ *
+ *  @param perf
+ *          The counters, left closed if the environment does not ask for
+ *          them.
+ *  @return
+ *          The number of counters that could be opened.
+ */
+int perfFromEnv(zmk_perf_t* perf)
+{
+    const char* env = getenv(PERF_ENV);
+    int i;
+
+    if (env == NULL || !*env || strcmp(env, "0") == 0)
+    {
+        memset(perf, 0, sizeof *perf);
+        for (i = 0; i < PERF_COUNTERS; ++i)
+        {
+            perf->fd[i] = -1;
+        }
+        return 0;
+    }
+    if (!perfOpen(perf))
+    {
+        fprintf(stderr, "%s: no counters available, running without\n",
+            PERF_ENV);
+    }
+    return perf->nOpen;
+}
+
+/**
+ *  Closes the counters.
+ */
+void perfClose(zmk_perf_t* perf)
+{
+    int i;
+
+    for (i = 0; i < PERF_COUNTERS; ++i)
+    {
+#ifdef __linux__
+        if (perf->fd[i] >= 0)
+        {
+            close(perf->fd[i]);
+        }
+#endif
+        perf->fd[i] = -1;
+    }
+    perf->nOpen = 0;
+}
+
+/**
+ *  Clears what has been counted.
+ */
+void perfReset(zmk_perf_t* perf)
+{
+    memset(perf->value, 0, sizeof perf->value);
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Starts counting. The counters run all the time, starting takes a
+ *  snapshot of each that {@code perfStop} subtracts.
+ *
+ *  @param perf
+ *          The counters.
+ */
+void perfStart(zmk_perf_t* perf)
+{
+#ifdef __linux__
+    int i;
+
+    for (i = 0; i < PERF_COUNTERS; ++i)
+    {
+        if (perf->fd[i] >= 0 && !perfRead(perf->fd[i], perf->start[i]))
+        {
+            memset(perf->start[i], 0, sizeof perf->start[i]);
+        }
+    }
+#else
+    (void) perf;
+#endif
+}
+
+/**
+ *  Stops counting and adds what was counted since {@code perfStart}.
+ *  <p>
+ *  A counter the kernel had switched out part of the time is scaled up by
+ *  the time it was enabled over the time it was running in between, as
+ *  perf does.
+ *
+ *  @param perf
+ *          The counters.
+ */
+void perfStop(zmk_perf_t* perf)
+{
+#ifdef __linux__
+    unsigned long long v[3];
+    unsigned long long enabled;
+    unsigned long long running;
+    int i;
+
+    for (i = 0; i < PERF_COUNTERS; ++i)
+    {
+        if (perf->fd[i] < 0 || !perfRead(perf->fd[i], v))
+        {
+            continue;
+        }
+        enabled = v[1] - perf->start[i][1];
+        running = v[2] - perf->start[i][2];
+        perf->value[i] += (double) (v[0] - perf->start[i][0])
+            * (running ? (double) enabled / running : 1.0);
+    }
+#else
+    (void) perf;
+#endif
+}
+
+/**
+ *  Prints what was counted, per solve, on a single line. Counters that are
+ *  not available are left out, the instructions per cycle are printed if
+ *  both are there.
+ *
+ *  @param perf
+ *          The counters.
+ *  @param solves
+ *          The number of solves counted.
+ */
+void printPerf(zmk_perf_t* perf, unsigned long long solves)
+{
+    const char* pre = "";
+    double v;
+    int i;
+
+    if (!perf->nOpen || !solves)
+    {
+        return;
+    }
+    printf("    per solve:");
+    for (i = 0; i < PERF_COUNTERS; ++i)
+    {
+        if (perf->fd[i] >= 0)
+        {
+            /* Counts of a few per solve keep their fraction. */
+            v = perf->value[i] / solves;
+            printf("%s %.*f %s", pre, v < 100 ? 2 : 0, v, perfNames[i]);
+            pre = ",";
+        }
+    }
+    if (perf->fd[PERF_CYCLES] >= 0 && perf->fd[PERF_INSTRUCTIONS] >= 0
+            && perf->value[PERF_CYCLES] > 0)
+    {
+        printf(", %.2f IPC",
+            perf->value[PERF_INSTRUCTIONS] / perf->value[PERF_CYCLES]);
+    }
+    putchar('\n');
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef PERF_H
+#define PERF_H
+
+/*
+ *  The benchmark reads hardware counters around every engine and test when
+ *  the environment variable PERF_ENV is set to anything but "0". A counter
+ *  the kernel or the machine does not offer is left out of the report.
+ */
+#define PERF_ENV        "ZMK_PERF"
+
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_PAGE_FAULTS,
+    PERF_COUNTERS
+};
+
+/**
+ *  A set of counters of the calling thread. Each counter has its own file
+ *  descriptor, -1 if it could not be opened, so that one missing counter
+ *  does not take the others with it. {@code value} sums what was counted
+ *  between each {@code perfStart} and {@code perfStop} since the last
+ *  {@code perfReset}, scaled up for the time the kernel had the counter
+ *  switched out. {@code start} holds the value, time enabled and time
+ *  running read by the last {@code perfStart}.
+ */
+typedef struct zmk_perf {
+    int fd[PERF_COUNTERS];
+    double value[PERF_COUNTERS];
+    unsigned long long start[PERF_COUNTERS][3];
+    int nOpen;
+} zmk_perf_t;
+
+int perfOpen(zmk_perf_t*);
+int perfFromEnv(zmk_perf_t*);
+void perfClose(zmk_perf_t*);
+void perfReset(zmk_perf_t*);
+void perfStart(zmk_perf_t*);
+void perfStop(zmk_perf_t*);
+void printPerf(zmk_perf_t*, unsigned long long);
+
+#endif
@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ *  My includes and defines.
+ */
+#include "coeff.h"
+#include "engine.h"
+#include "zmk.h"
+
+static unsigned long long   fm_count;
+
+unsigned long long zmk_fm_portfolio(char* aname, char* cname, int seconds)
+{
+    FILE*       afile = fopen(aname, "r");
+    FILE*       cfile = fopen(cname, "r");
+
+    fm_count = 0;
+
+    if (afile == NULL) {
+        fprintf(stderr, "could not open file A\n");
+        exit(1);
+    }
+
+    if (cfile == NULL) {
+        fprintf(stderr, "could not open file c\n");
+        exit(1);
+    }
+
+    ROW_T nEqn = 0;
+    INT_T nVar = 0;
+    ROW_T nEq = 0;
+
+    if (seconds == 0) {
+        /* Just run once for validation and tell which configuration won. */
+        const char* winner;
+        zmk_budget_t budget;
+        short limited = budgetFromEnv(&budget);
+        EQN_T*** eqns = parseSystemEq(afile, cfile, &nEqn, &nVar, &nEq);
+        if (eqns == NULL) {
+            fprintf(stderr, "values in A or c do not fit a coefficient\n");
+            exit(1);
+        }
+        INT_T res = zmkPortfolio(eqns, nEqn, nVar, nEq, 0,
+            limited ? &budget : NULL, &winner);
+
+        printf("portfolio: %s\n", winner != NULL ? winner : "none");
+        if (res == ZMK_BUDGET)
+            printBudget(&budget);
+
+        fclose(afile);
+        fclose(cfile);
+        return engineAnswer(res);
+    }
+
+    /*
+     *  Now loop until the time is up...
+     */
+    zmk_budget_t run;
+    budgetStart(&run, seconds, 0, 0);
+    while (budgetElapsed(&run) < seconds) {
+        rewind(afile);
+        rewind(cfile);
+        EQN_T*** eqns = parseSystemEq(afile, cfile, &nEqn, &nVar, &nEq);
+        if (eqns == NULL) {
+            fprintf(stderr, "values in A or c do not fit a coefficient\n");
+            exit(1);
+        }
+        zmkPortfolio(eqns, nEqn, nVar, nEq, 0, NULL, NULL);
+        fm_count++;
+    }
+    fclose(afile);
+    fclose(cfile);
+    return fm_count;
+}
+
+ZMK_ENGINE(zmk_fm_portfolio, ENGINE_EXACT | ENGINE_EQUALITIES | ENGINE_BUDGET
+    | ENGINE_THREADS)
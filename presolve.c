@@ -0,0 +1,960 @@
+#ifndef PRESOLVE_C
+#define PRESOLVE_C
+
+#include "coeff.h"
+#include "presolve.h"
+#include "util.h"
+#include "zmk.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ *  A row as handed to qsort, which has no other way of knowing the width.
+ */
+typedef struct presolve_row {
+    EQN_T** eqn;
+    INT_T nVar;
+} presolve_row_t;
+
+/*
+ *  The integer form of a row, divided by the gcd of all its entries and
+ *  negated if needed so that its first non-zero coefficient is positive.
+ *  Two rows are opposite exactly when their keys are equal and only one of
+ *  them was negated.
+ */
+typedef struct presolve_key {
+    const long long* key;
+    INT_T nVar;
+    ROW_T row;
+    INT_T flip;
+} presolve_key_t;
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Counts the non-zero coefficients of an equation.
+ *
+ *  @param eqn
+ *          The equation.
+ *  @param nVar
+ *          The number of coefficients, not counting the constant.
+ *  @param var
+ *          Set to the index of the last non-zero coefficient.
+ *  @return
+ *          The number of non-zero coefficients.
+ */
+static INT_T rowSupport(EQN_T** eqn, INT_T nVar, INT_T* var)
+{
+    INT_T n = 0;
+    INT_T i;
+    for (i = 0; i < nVar; ++i)
+    {
+        if (eqn[i]->nom)
+        {
+            *var = i;
+            ++n;
+        }
+    }
+    return n;
+}
+
+/**
+ *  Divides an equation by the greatest common divisor of its coefficients.
+ *  <p>
+ *  Only the constant can become fractional, rows that already have
+ *  fractional coefficients are left alone.
+ *
+ *  @param eqn
+ *          The equation to normalize.
+ *  @param nVar
+ *          The number of coefficients, not counting the constant.
+ *  @return
+ *          Non-zero if the equation was scaled.
+ */
+static INT_T normalizeRow(EQN_T** eqn, INT_T nVar)
+{
+    EQN_T* k = eqn[nVar];
+    INT_T g = 0;
+    INT_T h;
+    long denom;
+    INT_T i;
+
+    for (i = 0; i < nVar; ++i)
+    {
+        if (eqn[i]->denom != 1)
+        {
+            return 0;
+        }
+        g = gcdInt(g, eqn[i]->nom);
+    }
+    if (g <= 1)
+    {
+        return 0;
+    }
+
+    h = gcdInt(k->nom, g);
+    denom = (long) k->denom * (g / h);
+    if ((INT_T) denom != denom)
+    {
+        return 0;
+    }
+    k->nom /= h;
+    k->denom = (INT_T) denom;
+    reduceCoeff(k);
+
+    for (i = 0; i < nVar; ++i)
+    {
+        eqn[i]->nom /= g;
+    }
+    return 1;
+}
+
+/**
+ *  Returns whether two equations have the same coefficients, disregarding
+ *  the constant.
+ */
+static INT_T sameCoefficients(EQN_T** lhs, EQN_T** rhs, INT_T nVar)
+{
+    INT_T i;
+    for (i = 0; i < nVar; ++i)
+    {
+        if (lessThanCoeff(lhs[i], rhs[i]) || lessThanCoeff(rhs[i], lhs[i]))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ *  Orders rows by their coefficients, and rows with the same coefficients
+ *  tightest first. A larger constant {@code k} in {@code a x + k <= 0} is
+ *  the tighter row.
+ */
+static int compareRows(const void* ap, const void* bp)
+{
+    const presolve_row_t* a = ap;
+    const presolve_row_t* b = bp;
+    INT_T nVar = a->nVar;
+    INT_T i;
+
+    for (i = 0; i < nVar; ++i)
+    {
+        if (lessThanCoeff(a->eqn[i], b->eqn[i]))
+            return -1;
+        else if (lessThanCoeff(b->eqn[i], a->eqn[i]))
+            return +1;
+    }
+
+    if (lessThanCoeff(b->eqn[nVar], a->eqn[nVar]))
+        return -1;
+    else if (lessThanCoeff(a->eqn[nVar], b->eqn[nVar]))
+        return +1;
+    else
+        return 0;
+}
+
+/**
+ *  Returns whether a normalized upper bound {@code x + ku <= 0} and lower
+ *  bound {@code -x + kl <= 0} leave no room for {@code x}, i.e.
+ *  {@code kl > -ku}.
+ */
+static INT_T boundsCross(EQN_T** upper, EQN_T** lower, INT_T nVar)
+{
+    EQN_T* ku = upper[nVar];
+    EQN_T* kl = lower[nVar];
+    return (long) kl->nom * ku->denom + (long) ku->nom * kl->denom > 0;
+}
+
+/**
+ *  Orders keys by their entries, and equal keys unflipped first.
+ */
+static int compareKeys(const void* ap, const void* bp)
+{
+    const presolve_key_t* a = ap;
+    const presolve_key_t* b = bp;
+    INT_T i;
+
+    for (i = 0; i <= a->nVar; ++i)
+    {
+        if (a->key[i] != b->key[i])
+        {
+            return a->key[i] < b->key[i] ? -1 : +1;
+        }
+    }
+    return a->flip - b->flip;
+}
+
+/**
+ *  Divides integers by the gcd of their magnitudes.
+ */
+static void divideGcd(long long* v, INT_T n)
+{
+    long long g = 0;
+    INT_T i;
+
+    for (i = 0; i < n && g != 1; ++i)
+    {
+        g = gcdLong(v[i] < 0 ? -v[i] : v[i], g);
+    }
+    for (i = 0; g > 1 && i < n; ++i)
+    {
+        v[i] /= g;
+    }
+}
+
+/**
+ *  Eliminates column {@code var} from a row with an equality, scaling the row
+ *  by the magnitude of the equality's coefficient so that an inequality keeps
+ *  its direction.
+ *
+ *  @param e
+ *          The integer form of the equality.
+ *  @param r
+ *          The integer form of the row.
+ *  @param out
+ *          Room for the {@code nVar + 1} entries of the result, divided by
+ *          their gcd.
+ *  @return
+ *          Non-zero if the result does not fit a coefficient.
+ */
+static INT_T combineRow(const long long* e, const long long* r, INT_T var,
+        INT_T nVar, long long* out)
+{
+    long long a = e[var] < 0 ? -e[var] : e[var];
+    long long c = e[var] < 0 ? -r[var] : r[var];
+    long long x;
+    long long y;
+    INT_T overflow = 0;
+    INT_T j;
+
+    for (j = 0; j <= nVar; ++j)
+    {
+        overflow |= __builtin_mul_overflow(a, r[j], &x);
+        overflow |= __builtin_mul_overflow(c, e[j], &y);
+        overflow |= __builtin_sub_overflow(x, y, &out[j]);
+    }
+    divideGcd(out, nVar + 1);
+    for (j = 0; j <= nVar; ++j)
+    {
+        overflow |= (INT_T) out[j] != out[j] || (INT_T) -out[j] != -out[j];
+    }
+    return overflow;
+}
+
+/**
+ *  Substitutes the equality held by a row into every other row of a system,
+ *  removing from them the variable with the smallest coefficient in the
+ *  equality. Rows that are NULL or equal to {@code skip} are left out.
+ *  <p>
+ *  Either every row is rewritten or, if one of them would not fit, none is.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param n
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param row
+ *          The index of the equality.
+ *  @param skip
+ *          The index of another row to leave out, or {@code (ROW_T) -1}.
+ *  @return
+ *          1 if the variable was substituted, 0 if a row did not fit and -1
+ *          if the equality has no variables.
+ */
+static INT_T substituteRow(EQN_T*** eqns, ROW_T n, INT_T nVar, ROW_T row,
+        ROW_T skip)
+{
+    long long* e = (long long*) malloc(sizeof(long long) * 3 * (nVar + 1));
+    long long* r = e + nVar + 1;
+    long long* out = r + nVar + 1;
+    INT_T res = 1;
+    INT_T var = -1;
+    INT_T pass;
+    ROW_T i;
+    INT_T j;
+
+    if (e == NULL || !integerEquation(eqns[row], nVar, e))
+    {
+        free(e);
+        return 0;
+    }
+    for (j = 0; j < nVar; ++j)
+    {
+        if (e[j] && (var < 0 || llabs(e[j]) <= llabs(e[var])))
+        {
+            var = j;
+        }
+    }
+    if (var < 0)
+    {
+        free(e);
+        return -1;
+    }
+
+    /* The first pass only checks that every result fits. */
+    for (pass = 0; pass < 2 && res; ++pass)
+    {
+        for (i = 0; i < n && res; ++i)
+        {
+            if (i == row || i == skip || eqns[i] == NULL
+                    || !eqns[i][var]->nom)
+            {
+                continue;
+            }
+            if (!integerEquation(eqns[i], nVar, r)
+                    || combineRow(e, r, var, nVar, out))
+            {
+                res = 0;
+                break;
+            }
+            for (j = 0; pass && j <= nVar; ++j)
+            {
+                eqns[i][j]->nom = (INT_T) out[j];
+                eqns[i][j]->denom = 1;
+            }
+        }
+    }
+    free(e);
+    return res;
+}
+
+/**
+ *  Returns whether a single-variable row has been normalized to a unit
+ *  coefficient, i.e. describes a plain bound on its variable.
+ */
+static INT_T isBound(EQN_T** eqn, INT_T var)
+{
+    return eqn[var]->denom == 1 && (eqn[var]->nom == 1 || eqn[var]->nom == -1);
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Finds pairs of opposite rows with matching constants, i.e. equalities
+ *  written as two inequalities, and substitutes them into the rest of the
+ *  system, which removes both rows and one variable from all others.
+ *  <p>
+ *  Rows are compared by their integer forms, sorted so that opposite rows
+ *  are next to each other. The columns are kept, so that the system can be
+ *  in the middle of an elimination.
+ *
+ *  @param eqns
+ *          The system of equations, compacted in place.
+ *  @param nEqn
+ *          A pointer to the number of equations, updated on return.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @return
+ *          The number of equalities substituted.
+ */
+ROW_T implicitEqualities(EQN_T*** eqns, ROW_T* nEqn, INT_T nVar)
+{
+    presolve_key_t* keys;
+    long long* values;
+    long long* v;
+    ROW_T n = 0;
+    ROW_T found = 0;
+    INT_T first;
+    INT_T k;
+    ROW_T i;
+    ROW_T j;
+
+    if (*nEqn < 2)
+    {
+        return 0;
+    }
+    values = (long long*) malloc((sizeof(long long) * (nVar + 1)
+        + sizeof(presolve_key_t)) * *nEqn);
+    if (values == NULL)
+    {
+        return 0;
+    }
+    keys = (presolve_key_t*) (values + (size_t) (nVar + 1) * *nEqn);
+
+    for (i = 0; i < *nEqn; ++i)
+    {
+        v = values + (size_t) n * (nVar + 1);
+        if (!integerEquation(eqns[i], nVar, v))
+        {
+            continue;
+        }
+        for (first = 0; first < nVar && !v[first]; ++first)
+            ;
+        if (first == nVar)
+        {
+            continue;
+        }
+        divideGcd(v, nVar + 1);
+        keys[n].flip = v[first] < 0;
+        for (k = 0; keys[n].flip && k <= nVar; ++k)
+        {
+            v[k] = -v[k];
+        }
+        keys[n].key = v;
+        keys[n].nVar = nVar;
+        keys[n].row = i;
+        ++n;
+    }
+    qsort(keys, n, sizeof keys[0], compareKeys);
+
+    for (i = 0; i + 1 < n; ++i)
+    {
+        if (keys[i].flip || !keys[i + 1].flip
+                || memcmp(keys[i].key, keys[i + 1].key,
+                    sizeof(long long) * (nVar + 1)))
+        {
+            continue;
+        }
+        if (substituteRow(eqns, *nEqn, nVar, keys[i].row, keys[i + 1].row)
+                == 1)
+        {
+            freeEquation(eqns[keys[i].row], nVar + 1);
+            freeEquation(eqns[keys[i + 1].row], nVar + 1);
+            eqns[keys[i].row] = eqns[keys[i + 1].row] = NULL;
+            ++found;
+        }
+        ++i;
+    }
+
+    for (i = 0, j = 0; found && i < *nEqn; ++i)
+    {
+        if (eqns[i] != NULL)
+        {
+            eqns[j++] = eqns[i];
+        }
+    }
+    *nEqn -= 2 * found;
+
+    free(values);
+    return found;
+}
+
+/**
+ *  Substitutes the equalities at the front of a system into the rows after
+ *  them, leaving only inequalities. An equality that can not be substituted
+ *  because a row would overflow is kept as two opposite inequalities.
+ *
+ *  @param eqns
+ *          A pointer to the system, which may be reallocated.
+ *  @param nEqn
+ *          A pointer to the number of equations, updated on return.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param nEq
+ *          The number of equalities.
+ *  @param stats
+ *          Counts the equalities substituted.
+ *  @return
+ *          {@code ZMK_UNSAT} if an equality without variables does not
+ *          hold, {@code PRESOLVE_FAILED} if memory ran out, in which case
+ *          the equalities not yet substituted are left in place, and
+ *          {@code ZMK_UNKNOWN} otherwise.
+ */
+static INT_T explicitEqualities(EQN_T**** eqns, ROW_T* nEqn, INT_T nVar,
+        ROW_T nEq, presolve_stats_t* stats)
+{
+    EQN_T*** grown;
+    EQN_T** eqn;
+    EQN_T** negated;
+    INT_T res = ZMK_UNKNOWN;
+    ROW_T n = *nEqn;
+    INT_T k;
+    ROW_T i;
+    ROW_T j;
+
+    for (i = 0; i < nEq && res != PRESOLVE_FAILED; ++i)
+    {
+        eqn = (*eqns)[i];
+        switch (substituteRow(*eqns, n, nVar, i, (ROW_T) -1))
+        {
+        case -1:
+            if (eqn[nVar]->nom)
+            {
+                res = ZMK_UNSAT;
+            }
+            /* Fall through. */
+        case 1:
+            stats->nEqual++;
+            freeEquation(eqn, nVar + 1);
+            (*eqns)[i] = NULL;
+            break;
+        default:
+            grown = (EQN_T***) realloc(*eqns, sizeof(EQN_T**) * (n + 1));
+            negated = (EQN_T**) malloc(sizeof(EQN_T*) * (nVar + 1));
+            if (grown != NULL)
+            {
+                *eqns = grown;
+            }
+            if (grown == NULL || negated == NULL)
+            {
+                free(negated);
+                res = PRESOLVE_FAILED;
+                break;
+            }
+            for (k = 0; k <= nVar; ++k)
+            {
+                negated[k] = newCoeff(-eqn[k]->nom, eqn[k]->denom);
+            }
+            (*eqns)[n++] = negated;
+        }
+    }
+
+    for (i = 0, j = 0; i < n; ++i)
+    {
+        if ((*eqns)[i] != NULL)
+        {
+            (*eqns)[j++] = (*eqns)[i];
+        }
+    }
+    *nEqn = j;
+    return res;
+}
+
+
+/**
+ *  Propagates bounds on the variables through the rows until they no longer
+ *  move or {@code PROPAGATE_ROUNDS} passes are done, to catch a system
+ *  whose rows force some variable both above and below a value without any
+ *  elimination.
+ *  <p>
+ *  A row {@code a x + k <= 0} bounds each of its variables by the least
+ *  value the rest of the row can take under the current bounds of the
+ *  others. A pass takes each row once and costs one visit per coefficient.
+ *  The arithmetic is in doubles, rounded outward: every derived bound is
+ *  widened by more than the rounding error of the sum it came from, so the
+ *  bounds only ever contain the true ones and crossing bounds prove that
+ *  there is no solution.
+ *
+ *  @param rows
+ *          The rows of the system.
+ *  @param n
+ *          The number of rows.
+ *  @param nVar
+ *          The number of variables in each row.
+ *  @param nTightened
+ *          Set to the number of variables that got a bound.
+ *  @param outLo
+ *          Set to the lower bounds of the variables, may be NULL.
+ *  @param outUp
+ *          Set to the upper bounds of the variables, may be NULL.
+ *  @return
+ *          {@code ZMK_UNSAT} if the bounds of a variable cross,
+ *          {@code ZMK_UNKNOWN} otherwise.
+ */
+static INT_T propagateBounds(presolve_row_t* rows, ROW_T n, INT_T nVar,
+        INT_T* nTightened, double* outLo, double* outUp)
+{
+    double* a = (double*) malloc(sizeof(double) * ((size_t) n + 2)
+        * (nVar + 1));
+    double* lo = a + (size_t) n * (nVar + 1);
+    double* up = lo + nVar + 1;
+    long long* row = (long long*) malloc(sizeof(long long) * (nVar + 1));
+    char* usable = (char*) malloc(n + 1);
+    INT_T res = ZMK_UNKNOWN;
+    INT_T changed = 1;
+    INT_T round;
+    INT_T nInf;
+    INT_T inf;
+    ROW_T i;
+    INT_T j;
+    double* r;
+    double least;
+    double mag;
+    double t;
+    double b;
+    double slack;
+
+    *nTightened = 0;
+    for (j = 0; j < nVar && outLo != NULL; ++j)
+    {
+        outLo[j] = -HUGE_VAL;
+        outUp[j] = HUGE_VAL;
+    }
+    if (a == NULL || row == NULL || usable == NULL)
+    {
+        free(a);
+        free(row);
+        free(usable);
+        return res;
+    }
+
+    /* Rows whose integer form is exact in a double take part. */
+    for (i = 0; i < n; ++i)
+    {
+        usable[i] = integerEquation(rows[i].eqn, nVar, row);
+        for (j = 0; j <= nVar && usable[i]; ++j)
+        {
+            usable[i] = row[j] <= PROPAGATE_EXACT && row[j] >= -PROPAGATE_EXACT;
+            a[(size_t) i * (nVar + 1) + j] = (double) row[j];
+        }
+    }
+    for (j = 0; j < nVar; ++j)
+    {
+        lo[j] = -HUGE_VAL;
+        up[j] = HUGE_VAL;
+    }
+
+    for (round = 0; round < PROPAGATE_ROUNDS && changed && res == ZMK_UNKNOWN;
+            ++round)
+    {
+        changed = 0;
+        for (i = 0; i < n && res == ZMK_UNKNOWN; ++i)
+        {
+            if (!usable[i])
+            {
+                continue;
+            }
+
+            /* The least the row can be, less the terms that are unbounded. */
+            r = a + (size_t) i * (nVar + 1);
+            least = r[nVar];
+            mag = fabs(r[nVar]);
+            nInf = 0;
+            inf = -1;
+            for (j = 0; j < nVar; ++j)
+            {
+                if (r[j] == 0)
+                {
+                    continue;
+                }
+                b = r[j] > 0 ? lo[j] : up[j];
+                if (isinf(b))
+                {
+                    ++nInf;
+                    inf = j;
+                    continue;
+                }
+                t = r[j] * b;
+                least += t;
+                mag += fabs(t);
+            }
+            if (nInf > 1)
+            {
+                continue;
+            }
+
+            for (j = 0; j < nVar; ++j)
+            {
+                if (r[j] == 0 || (nInf && j != inf))
+                {
+                    continue;
+                }
+                t = nInf ? 0 : r[j] * (r[j] > 0 ? lo[j] : up[j]);
+                b = -(least - t) / r[j];
+                slack = 2 * ((nVar + 4) * DBL_EPSILON * mag / fabs(r[j])
+                    + DBL_EPSILON * fabs(b));
+                if (r[j] > 0 && b + slack < up[j]
+                        - PROPAGATE_GAIN * (1 + fabs(b)))
+                {
+                    *nTightened += isinf(up[j]) && isinf(lo[j]);
+                    up[j] = b + slack;
+                    changed = 1;
+                } else if (r[j] < 0 && b - slack > lo[j]
+                        + PROPAGATE_GAIN * (1 + fabs(b))) {
+                    *nTightened += isinf(up[j]) && isinf(lo[j]);
+                    lo[j] = b - slack;
+                    changed = 1;
+                }
+                if (lo[j] > up[j])
+                {
+                    res = ZMK_UNSAT;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (outLo != NULL)
+    {
+        memcpy(outLo, lo, sizeof(double) * nVar);
+        memcpy(outUp, up, sizeof(double) * nVar);
+    }
+    free(a);
+    free(row);
+    free(usable);
+    return res;
+}
+
+/**
+ *  Simplifies a system of equations before it is handed to the elimination.
+ *  <p>
+ *  Equalities are substituted away first, those given at the front of the
+ *  system as well as those written as two opposite inequalities, which
+ *  removes a variable each without adding rows.
+ *  <p>
+ *  All-zero rows are checked and removed, the remaining rows are divided by
+ *  the gcd of their coefficients and parallel rows are reduced to the
+ *  tightest one. This folds the single-variable rows of each variable into at
+ *  most one upper and one lower bound, which are checked against each other,
+ *  and then propagated through the other rows by {@code propagateBounds}.
+ *  A variable whose coefficients all have the same sign can always be moved
+ *  far enough to satisfy its rows, so those rows are dropped until no such
+ *  variable is left. Columns without any coefficients left are removed.
+ *  <p>
+ *  The system is updated in place and always holds {@code nEqn} valid rows of
+ *  {@code nVar + 1} coefficients on return, so the caller can free it.
+ *
+ *  @param system
+ *          A pointer to the system of equations, compacted in place and
+ *          reallocated if an equality has to be kept as two inequalities.
+ *  @param nEqn
+ *          A pointer to the number of equations, updated on return.
+ *  @param nVar
+ *          A pointer to the number of variables, updated on return.
+ *  @param nEq
+ *          The number of rows at the front of the system that are
+ *          equalities, {@code a x + k = 0}.
+ *  @param stats
+ *          Filled in with what was removed, may be NULL.
+ *  @param lo
+ *          Set to the lower bounds {@code propagateBounds} finds for the
+ *          variables, in the columns of the system as passed in, may be
+ *          NULL.
+ *  @param up
+ *          Set to the upper bounds likewise, may be NULL.
+ *  @return
+ *          {@code ZMK_SAT} or {@code ZMK_UNSAT} if presolve alone decided
+ *          the system, {@code PRESOLVE_FAILED} if memory ran out before the
+ *          equalities were substituted, {@code ZMK_UNKNOWN} otherwise.
+ */
+INT_T presolveSystem(EQN_T**** system, ROW_T* nEqn, INT_T* nVar, ROW_T nEq,
+        presolve_stats_t* stats, double* lo, double* up)
+{
+    presolve_stats_t local;
+    EQN_T*** eqns;
+    presolve_row_t* rows;
+    EQN_T*** upper;
+    EQN_T*** lower;
+    ROW_T* nPos;
+    ROW_T* nNeg;
+    INT_T* drop;
+    EQN_T** eqn;
+    INT_T res = ZMK_UNKNOWN;
+    INT_T changed;
+    INT_T var;
+    INT_T kept;
+    INT_T j;
+    ROW_T n = 0;
+    ROW_T m;
+    ROW_T i;
+
+    if (stats == NULL)
+    {
+        stats = &local;
+    }
+    memset(stats, 0, sizeof *stats);
+    stats->nIn = *nEqn;
+
+    if (nEq)
+    {
+        res = explicitEqualities(system, nEqn, *nVar, nEq, stats);
+    }
+    if (res == PRESOLVE_FAILED)
+    {
+        stats->nOut = *nEqn;
+        return res;
+    }
+    eqns = *system;
+    stats->nImplicit = implicitEqualities(eqns, nEqn, *nVar);
+    stats->nEqual += stats->nImplicit;
+
+    rows = (presolve_row_t*) malloc(sizeof(presolve_row_t) * (*nEqn + 1));
+    upper = (EQN_T***) calloc(*nVar + 1, sizeof(EQN_T**));
+    lower = (EQN_T***) calloc(*nVar + 1, sizeof(EQN_T**));
+    nPos = (ROW_T*) malloc(sizeof(ROW_T) * (*nVar + 1));
+    nNeg = (ROW_T*) malloc(sizeof(ROW_T) * (*nVar + 1));
+    drop = (INT_T*) malloc(sizeof(INT_T) * (*nVar + 1));
+
+    /* All-zero rows read 0 + k <= 0 and are checked on the spot. */
+    for (i = 0; i < *nEqn; ++i)
+    {
+        eqn = eqns[i];
+        if (!rowSupport(eqn, *nVar, &var))
+        {
+            stats->nZero++;
+            if (eqn[*nVar]->nom > 0)
+            {
+                res = ZMK_UNSAT;
+            }
+            freeEquation(eqn, *nVar + 1);
+            continue;
+        }
+        stats->nScaled += normalizeRow(eqn, *nVar);
+        rows[n].eqn = eqn;
+        rows[n].nVar = *nVar;
+        ++n;
+    }
+
+    /* Keep only the tightest of each set of parallel rows. */
+    qsort(rows, n, sizeof rows[0], compareRows);
+    for (i = 0, m = 0; i < n; ++i)
+    {
+        eqn = rows[i].eqn;
+        if (m && sameCoefficients(rows[m - 1].eqn, eqn, *nVar))
+        {
+            if (rowSupport(eqn, *nVar, &var) == 1)
+                stats->nBound++;
+            else
+                stats->nDup++;
+            freeEquation(eqn, *nVar + 1);
+            continue;
+        }
+        rows[m++] = rows[i];
+    }
+    n = m;
+
+    /* What is left of the single-variable rows are plain bounds. */
+    for (i = 0; i < n; ++i)
+    {
+        eqn = rows[i].eqn;
+        if (rowSupport(eqn, *nVar, &var) == 1 && isBound(eqn, var))
+        {
+            if (eqn[var]->nom > 0)
+                upper[var] = eqn;
+            else
+                lower[var] = eqn;
+        }
+    }
+    for (var = 0; var < *nVar; ++var)
+    {
+        if (upper[var] && lower[var]
+                && boundsCross(upper[var], lower[var], *nVar))
+        {
+            res = ZMK_UNSAT;
+        }
+    }
+
+    /* Bounds carried through the other rows may cross as well. */
+    if (res != ZMK_UNSAT
+            && propagateBounds(rows, n, *nVar, &stats->nPropagated, lo, up)
+                == ZMK_UNSAT)
+    {
+        res = ZMK_UNSAT;
+    }
+
+    /* Drop the rows of one-signed variables until there are none left. */
+    do {
+        changed = 0;
+        for (var = 0; var < *nVar; ++var)
+        {
+            nPos[var] = nNeg[var] = 0;
+        }
+        for (i = 0; i < n; ++i)
+        {
+            for (var = 0; var < *nVar; ++var)
+            {
+                if (rows[i].eqn[var]->nom > 0)
+                    nPos[var]++;
+                else if (rows[i].eqn[var]->nom < 0)
+                    nNeg[var]++;
+            }
+        }
+        for (var = 0; var < *nVar; ++var)
+        {
+            drop[var] = !nPos[var] != !nNeg[var];
+            changed |= drop[var];
+        }
+        if (!changed)
+        {
+            break;
+        }
+
+        for (i = 0, m = 0; i < n; ++i)
+        {
+            eqn = rows[i].eqn;
+            for (var = 0; var < *nVar; ++var)
+            {
+                if (drop[var] && eqn[var]->nom)
+                {
+                    break;
+                }
+            }
+            if (var < *nVar)
+            {
+                stats->nOneSign++;
+                freeEquation(eqn, *nVar + 1);
+                continue;
+            }
+            rows[m++] = rows[i];
+        }
+        n = m;
+    } while (changed);
+
+    /* Columns nobody uses any more, i.e. those with no signs, are removed. */
+    for (var = 0, kept = 0; var < *nVar; ++var)
+    {
+        drop[var] = !nPos[var] && !nNeg[var];
+        kept += !drop[var];
+    }
+    if (n && kept < *nVar)
+    {
+        for (i = 0; i < n; ++i)
+        {
+            eqn = rows[i].eqn;
+            for (var = 0, j = 0; var < *nVar; ++var)
+            {
+                if (drop[var])
+                    free(eqn[var]);
+                else
+                    eqn[j++] = eqn[var];
+            }
+            eqn[j] = eqn[*nVar];
+        }
+        stats->nVarDropped = *nVar - kept;
+        *nVar = kept;
+    }
+
+    if (res == ZMK_UNSAT)
+    {
+        for (i = 0; i < n; ++i)
+        {
+            freeEquation(rows[i].eqn, *nVar + 1);
+        }
+        n = 0;
+    } else if (!n) {
+        res = ZMK_SAT;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        eqns[i] = rows[i].eqn;
+    }
+    *nEqn = n;
+    stats->nOut = n;
+
+    free(rows);
+    free(upper);
+    free(lower);
+    free(nPos);
+    free(nNeg);
+    free(drop);
+    return res;
+}
+
+/**
+ *  Prints what a presolve pass removed on a single line.
+ *
+ *  @param stats
+ *          The counters filled in by {@code presolveSystem}.
+ */
+void printPresolveStats(presolve_stats_t* stats)
+{
+    printf("presolve: %zu rows in, %zu equalities (%zu implicit), %zu zero, "
+        "%zu scaled, %zu bounds folded, %d propagated, %zu parallel, "
+        "%zu one-signed, %d columns dropped, %zu rows left%s\n",
+        stats->nIn, stats->nEqual, stats->nImplicit, stats->nZero,
+        stats->nScaled, stats->nBound, (int) stats->nPropagated, stats->nDup,
+        stats->nOneSign, (int) stats->nVarDropped, stats->nOut,
+        stats->probed ? ", decided by a probe" : "");
+}
+
+#endif
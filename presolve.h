@@ -0,0 +1,46 @@
+#ifndef PRESOLVE_H
+#define PRESOLVE_H
+
+#include "coeff.h"
+
+/*
+ *  Bound propagation makes at most PROPAGATE_ROUNDS passes over the rows and
+ *  stops early once no bound moves by more than PROPAGATE_GAIN, relative to
+ *  its size. Rows with an integer form larger than PROPAGATE_EXACT, which a
+ *  double would round, are left out.
+ */
+#define PROPAGATE_ROUNDS    (8)
+#define PROPAGATE_GAIN      (1e-9)
+#define PROPAGATE_EXACT     (1LL << 53)
+
+/*
+ *  What presolveSystem returns if memory ran out while it substituted the
+ *  equalities. Those left would be read as inequalities from then on, so
+ *  the system can not be solved further and its callers answer ZMK_UNKNOWN.
+ */
+#define PRESOLVE_FAILED     (-5)
+
+/**
+ *  Counters describing what {@code presolveSystem} removed.
+ */
+typedef struct presolve_stats {
+    ROW_T nIn;          /* Rows handed to presolve. */
+    ROW_T nOut;         /* Rows left for elimination. */
+    ROW_T nEqual;       /* Equalities substituted away. */
+    ROW_T nImplicit;    /* Of those, pairs of opposite rows. */
+    ROW_T nZero;        /* All-zero rows checked and removed. */
+    ROW_T nScaled;      /* Rows divided by the gcd of their coefficients. */
+    ROW_T nBound;       /* Single-variable rows folded into a bound. */
+    INT_T nPropagated;  /* Variables bounded by propagation. */
+    ROW_T nDup;         /* Parallel rows dropped for a tighter one. */
+    ROW_T nOneSign;     /* Rows dropped with a one-signed variable. */
+    INT_T nVarDropped;  /* Columns removed from the system. */
+    short probed;       /* Decided by a point of the probe. */
+} presolve_stats_t;
+
+ROW_T implicitEqualities(EQN_T***, ROW_T*, INT_T);
+INT_T presolveSystem(EQN_T****, ROW_T*, INT_T*, ROW_T, presolve_stats_t*,
+        double*, double*);
+void printPresolveStats(presolve_stats_t*);
+
+#endif
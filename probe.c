@@ -0,0 +1,286 @@
+#ifndef PROBE_C
+#define PROBE_C
+
+#include "coeff.h"
+#include "presolve.h"
+#include "probe.h"
+#include "util.h"
+#include "zmk.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ *  The last point that satisfied a system on this thread, tried again on
+ *  the next system with as many variables. Each thread of zmkPortfolio
+ *  keeps its own.
+ */
+static __thread long long witness[PROBE_VARS];
+static __thread INT_T nWitness = -1;
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Checks a point against a row scaled to integers, exactly.
+ *
+ *  @param row
+ *          The {@code nVar} coefficients of the row and its constant.
+ *  @param x
+ *          The point.
+ *  @param nVar
+ *          The number of variables.
+ *  @param equality
+ *          Non-zero if the row reads {@code a x + k = 0}.
+ *  @return
+ *          Non-zero if the point satisfies the row, zero if it does not or
+ *          a value overflowed.
+ */
+static short rowHolds(const long long* row, const long long* x, INT_T nVar,
+        short equality)
+{
+    long long sum = row[nVar];
+    long long t;
+    int overflow = 0;
+    INT_T j;
+
+    for (j = 0; j < nVar; ++j)
+    {
+        overflow |= __builtin_mul_overflow(row[j], x[j], &t);
+        overflow |= __builtin_add_overflow(sum, t, &sum);
+    }
+    return !overflow && (equality ? sum == 0 : sum <= 0);
+}
+
+/**
+ *  Rounds a bound to an integer coordinate, zero if it is too large for a
+ *  double to hold it exactly.
+ */
+static long long roundBound(double v)
+{
+    return fabs(v) <= PROPAGATE_EXACT ? (long long) v : 0;
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Checks points against every row of a system. Each row is read once for
+ *  all of the points, and a point is dropped at the first row it violates.
+ *
+ *  @param a
+ *          The rows scaled to integers, {@code nVar + 1} entries each.
+ *  @param nEqn
+ *          The number of rows.
+ *  @param nVar
+ *          The number of variables.
+ *  @param nEq
+ *          The number of equalities at the front of the rows.
+ *  @param x
+ *          The points, {@code nVar} coordinates each.
+ *  @param n
+ *          The number of points, at most {@code PROBE_POINTS}.
+ *  @return
+ *          The first point that satisfies every row, -1 if there is none.
+ */
+static int probePoints(const long long* a, ROW_T nEqn, INT_T nVar,
+        ROW_T nEq, const long long* x, int n)
+{
+    unsigned alive = (1u << n) - 1;
+    const long long* row;
+    ROW_T i;
+    int p;
+
+    for (i = 0; i < nEqn && alive; ++i)
+    {
+        row = a + i * (nVar + 1);
+        for (p = 0; p < n; ++p)
+        {
+            if ((alive >> p & 1)
+                    && !rowHolds(row, x + p * nVar, nVar, i < nEq))
+            {
+                alive &= ~(1u << p);
+            }
+        }
+    }
+    return alive ? __builtin_ctz(alive) : -1;
+}
+
+/**
+ *  Keeps the point of a probe that satisfied every row as the witness.
+ *
+ *  @return
+ *          {@code ZMK_SAT} if a point did, {@code ZMK_UNKNOWN} otherwise.
+ */
+static INT_T probeFound(probe_t* probe, int found)
+{
+    if (found < 0)
+    {
+        return ZMK_UNKNOWN;
+    }
+    memcpy(witness, probe->x + found * probe->nVar,
+        sizeof(long long) * probe->nVar);
+    nWitness = probe->nVar;
+    return ZMK_SAT;
+}
+
+/**
+ *  Tries the first integer points on a system before it is eliminated, for
+ *  systems that are easily satisfied: the origin and the last point that
+ *  satisfied a system with as many variables on this thread. The rows are
+ *  kept scaled to integers, so that {@code probeBox} can try more points
+ *  once the system has been presolved in place. The points are checked
+ *  exactly, so a point that satisfies every row is a witness of the
+ *  system, kept for {@code probeWitness}. The system is not changed.
+ *
+ *  @param probe
+ *          The probe, to be freed with {@code probeEnd}. Its bounds are
+ *          room for {@code presolveSystem} to propagate the bounds of the
+ *          variables into, NULL if the system is not probed further.
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param nEq
+ *          The number of equalities at the front of the system.
+ *  @return
+ *          {@code ZMK_SAT} if a point satisfies every row,
+ *          {@code ZMK_UNKNOWN} otherwise.
+ */
+INT_T probeStart(probe_t* probe, EQN_T*** eqns, ROW_T nEqn, INT_T nVar,
+        ROW_T nEq)
+{
+    int n = 1;
+    ROW_T i;
+    INT_T j;
+
+    memset(probe, 0, sizeof *probe);
+    if (nVar > PROBE_VARS)
+    {
+        return ZMK_UNKNOWN;
+    }
+    probe->a = (long long*) malloc(sizeof(long long) * (nEqn + 1)
+        * (nVar + 1));
+    probe->x = (long long*) calloc((size_t) PROBE_POINTS * nVar + 1,
+        sizeof(long long));
+    probe->lo = (double*) malloc(sizeof(double) * 2 * (nVar + 1));
+    probe->nEqn = nEqn;
+    probe->nVar = nVar;
+    probe->nEq = nEq;
+    for (i = 0; i < nEqn && probe->a != NULL; ++i)
+    {
+        if (!integerEquation(eqns[i], nVar, probe->a + i * (nVar + 1)))
+        {
+            break;
+        }
+    }
+    if (probe->a == NULL || probe->x == NULL || probe->lo == NULL
+            || i < nEqn)
+    {
+        probeEnd(probe);
+        return ZMK_UNKNOWN;
+    }
+    probe->up = probe->lo + nVar + 1;
+    for (j = 0; j < nVar; ++j)
+    {
+        probe->lo[j] = -HUGE_VAL;
+        probe->up[j] = HUGE_VAL;
+    }
+
+    /* The origin, left at zero by calloc, and the last witness. */
+    if (nWitness == nVar)
+    {
+        memcpy(probe->x + n++ * nVar, witness, sizeof(long long) * nVar);
+    }
+    if (probeFound(probe, probePoints(probe->a, nEqn, nVar, nEq, probe->x,
+            n)) == ZMK_SAT)
+    {
+        probeEnd(probe);
+        return ZMK_SAT;
+    }
+    return ZMK_UNKNOWN;
+}
+
+/**
+ *  Tries two more points on a system after {@code probeStart}, from the
+ *  bounds of its variables: the point of the bound box closest to the
+ *  origin and the middle of the box, each rounded to the integers and taken
+ *  as the origin along variables without bounds.
+ *
+ *  @param probe
+ *          The probe, its bounds filled in.
+ *  @return
+ *          {@code ZMK_SAT} if a point satisfies every row,
+ *          {@code ZMK_UNKNOWN} otherwise.
+ */
+INT_T probeBox(probe_t* probe)
+{
+    INT_T nVar = probe->nVar;
+    const double* lo = probe->lo;
+    const double* up = probe->up;
+    long long* x = probe->x;
+    INT_T j;
+
+    if (probe->a == NULL)
+    {
+        return ZMK_UNKNOWN;
+    }
+    for (j = 0; j < nVar; ++j)
+    {
+        x[j] = lo[j] > 0 ? roundBound(ceil(lo[j]))
+            : up[j] < 0 ? roundBound(floor(up[j])) : 0;
+        x[nVar + j] = isinf(lo[j]) && isinf(up[j]) ? 0
+            : isinf(up[j]) ? roundBound(ceil(lo[j]))
+            : isinf(lo[j]) ? roundBound(floor(up[j]))
+            : roundBound(floor(lo[j] / 2 + up[j] / 2 + 0.5));
+    }
+    return probeFound(probe, probePoints(probe->a, probe->nEqn, nVar,
+        probe->nEq, x, 2));
+}
+
+/**
+ *  Frees what a probe keeps of its system.
+ */
+void probeEnd(probe_t* probe)
+{
+    free(probe->a);
+    free(probe->x);
+    free(probe->lo);
+    memset(probe, 0, sizeof *probe);
+}
+
+/**
+ *  Returns the last point that satisfied a system probed on this thread.
+ *
+ *  @param nVar
+ *          Set to the number of coordinates of the point, -1 if there is
+ *          none.
+ */
+const long long* probeWitness(INT_T* nVar)
+{
+    *nVar = nWitness;
+    return witness;
+}
+
+/**
+ *  Prints the last point that satisfied a system probed on this thread on
+ *  a single line.
+ */
+void printProbe(void)
+{
+    INT_T j;
+
+    printf("probe: witness (");
+    for (j = 0; j < nWitness; ++j)
+    {
+        printf(j ? ", %lld" : "%lld", witness[j]);
+    }
+    printf(")\n");
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef PROBE_H
+#define PROBE_H
+
+#include "coeff.h"
+
+/*
+ *  A probe tries at most PROBE_POINTS integer points on a system at once
+ *  before it is eliminated. Systems with more than PROBE_VARS variables are not
+ *  probed, which bounds the witness kept for the next system.
+ */
+#define PROBE_POINTS    (4)
+#define PROBE_VARS      (256)
+
+/**
+ *  The rows of a system scaled to integers, kept by {@code probeStart} to
+ *  try more points on once {@code presolveSystem} has bounded the variables
+ *  in {@code lo} and {@code up}.
+ */
+typedef struct probe {
+    long long* a;           /* The rows, NULL if there is nothing to try. */
+    long long* x;           /* Room for PROBE_POINTS points. */
+    double* lo;             /* Lower bounds of the variables. */
+    double* up;             /* Upper bounds of the variables. */
+    ROW_T nEqn;
+    INT_T nVar;
+    ROW_T nEq;
+} probe_t;
+
+INT_T probeStart(probe_t*, EQN_T***, ROW_T, INT_T, ROW_T);
+INT_T probeBox(probe_t*);
+void probeEnd(probe_t*);
+const long long* probeWitness(INT_T*);
+void printProbe(void);
+
+#endif
@@ -1,11 +1,13 @@
 #!/bin/sh
 
+SRC="main.c run_fm.c zmk_fm_fast.c engine.c fast.c cached.c small.c coeff.c util.c presolve.c cache.c daemon.c zmk_fm_fixed.c zmk_fm_float.c zmk_fm_sparse.c zmk_fm_small.c budget.c corpus.c component.c portfolio.c zmk_fm_portfolio.c farkas.c perf.c step.c omega.c probe.c"
+
 rm -f fast small *.o *.gcda                         &&
-gcc -O3 -m64 -maltivec -mcpu=970 fast.c main.c -fprofile-generate -o fast   &&
+gcc -O3 -m64 -maltivec -mcpu=970 $SRC -lm -lpthread -fprofile-generate -o fast   &&
 ./fast 10                                   &&
-gcc -O3 -m64 -maltivec -mcpu=970 fast.c main.c -fprofile-use -o fast        &&
+gcc -O3 -m64 -maltivec -mcpu=970 $SRC -lm -lpthread -fprofile-use -o fast        &&
 ./fast 60                                   &&
-gcc -Os -m32 -mcpu=970 small.c main.c -o small                  &&
+gcc -Os -m32 -mcpu=970 $SRC -lm -lpthread -o small                  &&
 ./small 1                                   &&
-gcc -Os -m32 -mcpu=970 small.c -c                       &&
-size --common small.o
+gcc -Os -m32 -mcpu=970 small.c zmk_fm_small.c -c                       &&
+size --common small.o zmk_fm_small.o
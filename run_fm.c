@@ -7,6 +7,19 @@
 #include <stdlib.h>
 #include <string.h>
 
+/**
+ * Checks that a value read fits a coefficient, as does its negation.
+ *
+ * @param value
+ *          The value read.
+ * @return
+ *          Non-zero if it fits.
+ */
+static short fitsCoeff(long value)
+{
+    return value == (INT_T) value && -value == (INT_T) -value;
+}
+
 /**
  * Reads numbers from a file into an equation.
  *
@@ -17,38 +30,130 @@
  * @param isC
  *          A flag specifying whether or not a file of constants is read.
  * @return
- *          A pointer to an array of coefficients describing an equation.
+ *          A pointer to an array of coefficients describing an equation, with
+ *          room for one more coefficient (the constant), or NULL if a value
+ *          does not fit a coefficient.
  */
 EQN_T** parseEquation(FILE* file, INT_T nVar, INT_T isC)
 {
-    EQN_T **arr = (EQN_T **) malloc(sizeof(EQN_T*) * nVar);
-    INT_T tmp = 0;
+    EQN_T **arr = (EQN_T **) malloc(sizeof(EQN_T*) * (nVar + 1));
+    long tmp = 0;
     INT_T i;
     
     if (isC)
     {
-        fscanf(file, "%hi\n", &tmp);
-        for (i = 0; i < nVar; ++i)
+        fscanf(file, "%ld\n", &tmp);
+    }
+    for (i = 0; i < nVar; ++i)
+    {
+        fscanf(file, isC ? "%ld\n" : "%ld", &tmp);
+        if (!fitsCoeff(tmp))
         {
-            fscanf(file, "%hi\n", &tmp);
-            arr[i] = newCoeff(tmp, 1);
+            freeEquation(arr, i);
+            return NULL;
         }
-        return arr;
+        arr[i] = newCoeff((INT_T) tmp, 1);
     }
 
-    for (i = 0; i < nVar; ++i)
+    return arr;
+}
+
+/**
+ * Reads a file into an equation block like {@code parseSystem}, but keeps
+ * equalities as single rows, moved to the front of the system.
+ *
+ * @param fileA
+ *          The file to read containing the coefficients.
+ * @param fileC
+ *          The file to read containing the constants, each preceded by '='
+ *          if its row is an equality.
+ * @param nEqn
+ *          A pointer to a count to contain the number of equations.
+ * @param nVar
+ *          A pointer to an integer to contain the number of coefficients.
+ * @param nEq
+ *          A pointer to a count to contain the number of equalities.
+ * @return
+ *          A pointer to an array of equations, the first {@code nEq} of
+ *          which read {@code a x + k = 0} and the others {@code a x + k <= 0},
+ *          or NULL with all counts zero if a value does not fit a
+ *          coefficient, as the system would not be the one in the files.
+ */
+EQN_T*** parseSystemEq(FILE* fileA, FILE* fileC, ROW_T* nEqn, INT_T* nVar,
+        ROW_T* nEq)
+{
+    char mark[2];
+    long tmp = 0;
+    ROW_T i;
+    ROW_T p;
+
+    /* A header that does not fit reads as an empty system. */
+    if (fscanf(fileA, "%zu %ld\n", nEqn, &tmp) != 2 || tmp < 0
+            || tmp != (INT_T) tmp)
     {
-        fscanf(file, "%hi", &tmp);
-        arr[i] = newCoeff(tmp, 1);
+        *nEqn = 0;
+        tmp = 0;
     }
+    *nVar = (INT_T) tmp;
+    fscanf(fileC, "%ld\n", &tmp);
 
-    return arr;
+    EQN_T*** eqns = (EQN_T ***) malloc(sizeof(EQN_T **) * (*nEqn));
+    char* isEq = (char*) malloc(*nEqn + 1);
+
+    for (i = 0, *nEq = 0; i < (*nEqn); ++i)
+    {
+        eqns[i] = parseEquation(fileA, *nVar, 0);
+        isEq[i] = fscanf(fileC, " %1[=]", mark) == 1;
+        fscanf(fileC, "%ld\n", &tmp);
+        if (eqns[i] == NULL || !fitsCoeff(tmp))
+        {
+            if (eqns[i] != NULL)
+            {
+                freeEquation(eqns[i], *nVar);
+            }
+            freeSystem(eqns, i, *nVar + 1);
+            free(isEq);
+            *nEqn = 0;
+            *nVar = 0;
+            *nEq = 0;
+            return NULL;
+        }
+        eqns[i][*nVar] = newCoeff((INT_T) -tmp, 1);
+        *nEq += isEq[i];
+    }
+
+    /* Equalities move to the front, the other rows keep their order. */
+    if (*nEq)
+    {
+        EQN_T*** ordered = (EQN_T ***) malloc(sizeof(EQN_T **) * (*nEqn));
+
+        for (i = 0, p = 0; i < (*nEqn); ++i)
+        {
+            if (isEq[i])
+            {
+                ordered[p++] = eqns[i];
+            }
+        }
+        for (i = 0; i < (*nEqn); ++i)
+        {
+            if (!isEq[i])
+            {
+                ordered[p++] = eqns[i];
+            }
+        }
+        free(eqns);
+        eqns = ordered;
+    }
+    free(isEq);
+
+    return eqns;
 }
 
 /**
  * Reads a file into an equation block. The first file is expected to have two
  * numbers on each line delimited by a singular space, the other file is
- * expected to have an isolated number on each line.
+ * expected to have an isolated number on each line. A number preceded by
+ * '=' makes its row an equality, which is read as two opposite rows.
  *
  *
  * @param fileA
@@ -57,30 +162,35 @@ EQN_T** parseEquation(FILE* file, INT_T nVar, INT_T isC)
  *          The file to read containing the constant solutions to the
  *          relational equations.
  * @param nEqn
- *          A pointer to an integer to contain the number of equations.
+ *          A pointer to a count to contain the number of equations.
  * @param nVar
  *          A pointer to an integer to contain the number of coefficients.
  * @return
- *          A pointer to an array of equations describing a system of equations.
+ *          A pointer to an array of equations describing a system of equations,
+ *          or NULL if a value does not fit a coefficient.
  */
             
-EQN_T*** parseSystem(FILE* fileA, FILE* fileC, INT_T* nEqn, INT_T* nVar)
+EQN_T*** parseSystem(FILE* fileA, FILE* fileC, ROW_T* nEqn, INT_T* nVar)
 {
-    INT_T i;
+    ROW_T nEq;
+    ROW_T i;
+    INT_T j;
 
-    fscanf(fileA, "%hu %hu\n", nEqn, nVar);
-    
-    EQN_T** cs = parseEquation(fileC, *nEqn, 1);
-
-    EQN_T*** eqns = (EQN_T ***) malloc(sizeof(EQN_T **) * (*nEqn));
+    EQN_T*** eqns = parseSystemEq(fileA, fileC, nEqn, nVar, &nEq);
 
-    for (i = 0; i < (*nEqn); ++i)
+    if (nEq)
     {
-        eqns[i] = parseEquation(fileA, *nVar, 0);
-        cs[i]->nom *= -1;
-        eqns[i][*nVar] = cs[i];
+        eqns = (EQN_T ***) realloc(eqns, sizeof(EQN_T **) * (*nEqn + nEq));
+        for (i = 0; i < nEq; ++i)
+        {
+            eqns[*nEqn + i] = (EQN_T **) malloc(sizeof(EQN_T*) * (*nVar + 1));
+            for (j = 0; j <= *nVar; ++j)
+            {
+                eqns[*nEqn + i][j] = newCoeff(-eqns[i][j]->nom, 1);
+            }
+        }
+        *nEqn += nEq;
     }
-    free(cs);
 
     return eqns;
 }
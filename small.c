@@ -1,25 +1,42 @@
-#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <signal.h>
-#include <unistd.h>
+
+/*
+ *  My includes and defines.
+ */
+#include "coeff.h"
+#include "engine.h"
+#include "util.h"
+#include "zmk.h"
 
 static unsigned long long   fm_count;
-static volatile bool        proceed = false;
 
-static void done(int unused)
+/*
+ *  Decides a system with zmkSmall alone, so that a system that does not fit
+ *  its buffer is reported as such rather than solved on the heap.
+ */
+static INT_T solve(FILE* afile, FILE* cfile, size_t* peak)
 {
-    proceed = false;
-    unused = unused;
+    ROW_T nEqn = 0;
+    INT_T nVar = 0;
+    EQN_T*** eqns = parseSystem(afile, cfile, &nEqn, &nVar);
+    INT_T res;
+
+    if (eqns == NULL) {
+        fprintf(stderr, "values in A or c do not fit a coefficient\n");
+        exit(1);
+    }
+    res = zmkSmall(eqns, nEqn, nVar, peak);
+    freeSystem(eqns, nEqn, nVar + 1);
+    return res;
 }
     
 unsigned long long zmk_fm_small(char* aname, char* cname, int seconds)
 {
     FILE*       afile = fopen(aname, "r");
     FILE*       cfile = fopen(cname, "r");
+    size_t      peak;
 
-    printf("Got here.\n");
-    
     fm_count = 0;
 
     if (afile == NULL) {
@@ -32,24 +49,36 @@ unsigned long long zmk_fm_small(char* aname, char* cname, int seconds)
         exit(1);
     }
 
-    fclose(afile);
-    fclose(cfile);
-
     if (seconds == 0) {
         /* Just run once for validation. */
-            
-        return 0;
-    }
+        INT_T res = solve(afile, cfile, &peak);
 
-    /* Tell operating system to call function DONE when an ALARM comes. */
-    signal(SIGALRM, done);
-    alarm(seconds);
+        if (res == ZMK_BUDGET)
+            printf("small: does not fit %zu bytes\n",
+                (size_t) SMALL_BYTES);
+        else if (res == ZMK_UNKNOWN)
+            printf("small: a value overflowed\n");
+        else
+            printf("small: peak %zu of %zu bytes\n", peak,
+                (size_t) SMALL_BYTES);
 
-    /* Now loop until the alarm comes... */
-    proceed = true;
-    while (proceed) {
-        fm_count++;
+        fclose(afile);
+        fclose(cfile);
+        return engineAnswer(res);
     }
 
+    /* Now loop until the time is up... */
+    zmk_budget_t run;
+    budgetStart(&run, seconds, 0, 0);
+    while (budgetElapsed(&run) < seconds) {
+        rewind(afile);
+        rewind(cfile);
+        solve(afile, cfile, NULL);
+        fm_count++;
+    }
+    fclose(afile);
+    fclose(cfile);
     return fm_count;
 }
+
+ZMK_ENGINE(zmk_fm_small, ENGINE_EXACT | ENGINE_FIXED)
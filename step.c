@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ *  My includes and defines.
+ */
+#include "coeff.h"
+#include "engine.h"
+#include "util.h"
+#include "zmk.h"
+
+static unsigned long long   fm_count;
+
+/*
+ *  Decides a system with zmkStep, STEP_WORK units at a time as an event
+ *  loop would, leaving those whose coefficients overflow to zmkSolve.
+ */
+static INT_T solve(FILE* afile, FILE* cfile)
+{
+    ROW_T nEqn = 0;
+    INT_T nVar = 0;
+    ROW_T nEq = 0;
+    EQN_T*** eqns = parseSystemEq(afile, cfile, &nEqn, &nVar, &nEq);
+    zmk_step_t* s;
+    INT_T res = ZMK_UNKNOWN;
+
+    if (eqns == NULL) {
+        fprintf(stderr, "values in A or c do not fit a coefficient\n");
+        exit(1);
+    }
+    s = zmkStepStart(eqns, nEqn, nVar, nEq, NULL);
+    if (s != NULL) {
+        while ((res = zmkStep(s, STEP_WORK)) == ZMK_PENDING)
+            ;
+        zmkStepFree(s);
+    }
+
+    if (res == ZMK_UNKNOWN || res == ZMK_BUDGET) {
+        rewind(afile);
+        rewind(cfile);
+        eqns = parseSystemEq(afile, cfile, &nEqn, &nVar, &nEq);
+        res = zmkSolveEq(eqns, nEqn, nVar, nEq, NULL, NULL);
+    }
+    return res;
+}
+
+unsigned long long zmk_fm_step(char* aname, char* cname, int seconds)
+{
+    FILE*       afile = fopen(aname, "r");
+    FILE*       cfile = fopen(cname, "r");
+
+    fm_count = 0;
+
+    if (afile == NULL) {
+        fprintf(stderr, "could not open file A\n");
+        exit(1);
+    }
+
+    if (cfile == NULL) {
+        fprintf(stderr, "could not open file c\n");
+        exit(1);
+    }
+
+    if (seconds == 0) {
+        /* Just run once for validation. */
+        INT_T res = solve(afile, cfile);
+
+        fclose(afile);
+        fclose(cfile);
+        return engineAnswer(res);
+    }
+
+    /* Now loop until the time is up... */
+    zmk_budget_t run;
+    budgetStart(&run, seconds, 0, 0);
+    while (budgetElapsed(&run) < seconds) {
+        rewind(afile);
+        rewind(cfile);
+        solve(afile, cfile);
+        fm_count++;
+    }
+    fclose(afile);
+    fclose(cfile);
+    return fm_count;
+}
+
+ZMK_ENGINE(zmk_fm_step, ENGINE_EXACT | ENGINE_EQUALITIES)
@@ -95,9 +95,9 @@ void freeEquation(EQN_T** arr, INT_T cols)
  *  @param rows
  *          The number of rows in the matrix.
  */
-void freeSystem(EQN_T*** mat, INT_T rows, INT_T cols)
+void freeSystem(EQN_T*** mat, ROW_T rows, INT_T cols)
 {
-    INT_T i;
+    ROW_T i;
     for (i = 0; i < rows; ++i)
     {
         freeEquation(mat[i], cols);
@@ -105,9 +105,47 @@ void freeSystem(EQN_T*** mat, INT_T rows, INT_T cols)
     free(mat);
 }
 
+/**
+ *  Scales an equation to integers by the lcm of its denominators.
+ *
+ *  @param eqn
+ *          The equation to scale.
+ *  @param nVar
+ *          The number of coefficients, not counting the constant.
+ *  @param out
+ *          Room for the {@code nVar + 1} scaled coefficients.
+ *  @return
+ *          Zero if the scaled equation does not fit or has a zero
+ *          denominator, left by an overflow, non-zero otherwise.
+ */
+short integerEquation(EQN_T** eqn, INT_T nVar, long long* out)
+{
+    long long lcm = 1;
+    INT_T i;
+
+    for (i = 0; i <= nVar; ++i)
+    {
+        if (!eqn[i]->denom
+                || __builtin_mul_overflow(lcm / gcdLong(lcm, eqn[i]->denom),
+                    (long long) eqn[i]->denom, &lcm))
+        {
+            return 0;
+        }
+    }
+    for (i = 0; i <= nVar; ++i)
+    {
+        if (__builtin_mul_overflow((long long) eqn[i]->nom,
+                lcm / eqn[i]->denom, &out[i]))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 void printCoeff(EQN_T* eqn)
 {
-    printf("(%hi/%hi)", eqn->nom, eqn->denom);
+    printf("(%d/%d)", (int) eqn->nom, (int) eqn->denom);
 }
 
 /**
@@ -136,9 +174,9 @@ void printEquation(EQN_T** eqn, INT_T nVar)
  *  @param eqns
  *          The equations to print.
  */
-void printSystem(EQN_T*** eqns, INT_T len, INT_T nVar)
+void printSystem(EQN_T*** eqns, ROW_T len, INT_T nVar)
 {
-    INT_T i;
+    ROW_T i;
     printf("[\n");
     for (i = 0; i < len; ++i)
     {
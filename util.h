@@ -8,9 +8,10 @@ void error(char*);
 void printLn(char*);
 void swap(void*, void*);
 void freeEquation(EQN_T**, INT_T);
-void freeSystem(EQN_T***, INT_T, INT_T);
+void freeSystem(EQN_T***, ROW_T, INT_T);
+short integerEquation(EQN_T**, INT_T, long long*);
 void printCoeff(EQN_T*);
 void printEquation(EQN_T**, INT_T);
-void printSystem(EQN_T***, INT_T, INT_T);
+void printSystem(EQN_T***, ROW_T, INT_T);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef ZMK_H
+#define ZMK_H
+
+#include "budget.h"
+#include "coeff.h"
+#include "presolve.h"
+#include <stdio.h>
+
+/*
+ *  Results shared by the solver stages. A stage that can not decide a
+ *  system on its own returns ZMK_UNKNOWN and leaves it to the next one, a
+ *  stage that ran out of its budget returns ZMK_BUDGET and ends the solve.
+ */
+#define ZMK_UNSAT   (0)
+#define ZMK_SAT     (1)
+#define ZMK_UNKNOWN (-1)
+#define ZMK_BUDGET  (-2)
+
+/*
+ *  A solve run step by step by zmkStep returns ZMK_PENDING while it has
+ *  work left. The driver of zmk_fm_step gives each step STEP_WORK units.
+ *  Only the pairing of rows is sliced: zmkStepStart presolves the system
+ *  and the step that starts a level sorts all of it in one go, so those
+ *  are bounded by the size of the system and not by the work given. A
+ *  stepped solve takes no budget, its caller bounds it by the steps it
+ *  runs.
+ */
+#define ZMK_PENDING (-3)
+
+#ifndef STEP_WORK
+#define STEP_WORK   (1 << 12)
+#endif
+
+typedef struct zmk_step zmk_step_t;
+
+/*
+ *  Systems in which at most this fraction of the coefficients is non-zero
+ *  are handed to the sparse engine.
+ */
+#define SPARSE_DENSITY  (0.3f)
+
+/*
+ *  The size of the one buffer zmkSmall eliminates in.
+ */
+#ifndef SMALL_BYTES
+#define SMALL_BYTES     (1 << 18)
+#endif
+
+/*
+ *  Levels pair their positive and negative rows tile by tile, each tile
+ *  taking at most TILE_BYTES of rows from either side so that both fit in
+ *  the L1 cache while the combinations are written out.
+ */
+#ifndef TILE_BYTES
+#define TILE_BYTES      (1 << 14)
+#endif
+#define TILE_ROWS(b)    ((b) < TILE_BYTES ? TILE_BYTES / (b) : 1)
+
+/*
+ *  The number of threads solving the components of a system, one if the
+ *  environment variable is not set.
+ */
+#define THREADS_ENV     "ZMK_THREADS"
+
+EQN_T*** parseSystem(FILE*, FILE*, ROW_T*, INT_T*);
+EQN_T*** parseSystemEq(FILE*, FILE*, ROW_T*, INT_T*, ROW_T*);
+INT_T zmkSolve(EQN_T***, ROW_T, INT_T, presolve_stats_t*, zmk_budget_t*);
+INT_T zmkSolveEq(EQN_T***, ROW_T, INT_T, ROW_T, presolve_stats_t*,
+        zmk_budget_t*);
+INT_T zmkComponents(EQN_T***, ROW_T, INT_T, zmk_budget_t*);
+INT_T zmkEliminate(EQN_T***, ROW_T, INT_T, zmk_budget_t*);
+INT_T zmkPortfolio(EQN_T***, ROW_T, INT_T, ROW_T, int, zmk_budget_t*,
+        const char**);
+INT_T zmkFixed(EQN_T***, ROW_T, INT_T, zmk_budget_t*);
+INT_T zmkFloat(EQN_T***, ROW_T, INT_T, zmk_budget_t*);
+float systemDensity(EQN_T***, ROW_T, INT_T);
+INT_T zmkSparse(EQN_T***, ROW_T, INT_T, zmk_budget_t*);
+INT_T zmkSmall(EQN_T***, ROW_T, INT_T, size_t*);
+INT_T zmkFast(EQN_T***, ROW_T, INT_T, zmk_budget_t*);
+INT_T zmkFastDebug(EQN_T***, ROW_T, INT_T);
+zmk_step_t* zmkStepStart(EQN_T***, ROW_T, INT_T, ROW_T, presolve_stats_t*);
+INT_T zmkStep(zmk_step_t*, size_t);
+void zmkStepFree(zmk_step_t*);
+
+#endif
@@ -1,38 +1,219 @@
 #ifndef ZMK_FM_fast_C
 #define ZMK_FM_fast_C
 
+#include "coeff.h"
+#include "probe.h"
 #include "util.h"
+#include "zmk.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <float.h>
+#include <string.h>
+
+/*
+ *  Every row of zmkFast carries the columns of its positive and of its
+ *  negative coefficients as bit masks of MASK_WORDS(nVar) words each. The
+ *  masks of all rows are kept back to back in one array, those of row i
+ *  start at 2 * w * i with the positive words first.
+ */
+typedef unsigned long long mask_t;
+
+#define MASK_BITS       (64)
+#define MASK_WORDS(n)   (((n) + MASK_BITS - 1) / MASK_BITS)
+#define MASK_WORD(k)    ((k) / MASK_BITS)
+#define MASK_BIT(k)     ((mask_t) 1 << ((k) % MASK_BITS))
 
 void printEquation(EQN_T**, INT_T);
-void printSystem(EQN_T***, INT_T, INT_T);
+void printSystem(EQN_T***, ROW_T, INT_T);
 
-/* ========== *
- *  Utility.  *
- * ========== */
+/* ======= *
+ *  Mask.  *
+ * ======= */
 
 /**
- *  Prints an array of integers. Used for debugging.
+ *  Sets the masks of a row from its coefficients.
  *
- *  @param array
- *          The array to print.
- *  @param len
- *          The number of elements in the array.
- *  @param name
- *          The name of the array.
- */
-void printIntegerArray(INT_T* array, INT_T len, char* name)
+ *  @param mask
+ *          The masks of the row.
+ *  @param eqn
+ *          The equation.
+ *  @param nVar
+ *          The number of coefficients, not counting the constant.
+ *  @param w
+ *          The number of words in each mask.
+ */
+static void maskEquation(mask_t* mask, EQN_T** eqn, INT_T nVar, INT_T w)
 {
-    INT_T i;
-    char* pre = "";
-    printf("%s = [", name);
-    for (i = 0; i < len; ++i) {
-        printf("%s%hi", pre, array[i]);
-        pre = ", ";
+    INT_T j;
+
+    memset(mask, 0, sizeof(mask_t) * 2 * w);
+    for (j = 0; j < nVar; ++j)
+    {
+        if (eqn[j]->nom > 0)
+            mask[MASK_WORD(j)] |= MASK_BIT(j);
+        else if (eqn[j]->nom < 0)
+            mask[w + MASK_WORD(j)] |= MASK_BIT(j);
+    }
+}
+
+/**
+ *  Returns the sign of the coefficient of column {@code k} of a row.
+ */
+static INT_T maskSign(const mask_t* mask, INT_T k, INT_T w)
+{
+    if (mask[MASK_WORD(k)] & MASK_BIT(k))
+        return 1;
+    else if (mask[w + MASK_WORD(k)] & MASK_BIT(k))
+        return -1;
+    else
+        return 0;
+}
+
+/**
+ *  Swaps the bits of columns {@code a} and {@code b} in both masks of a row.
+ */
+static void maskSwap(mask_t* mask, INT_T a, INT_T b, INT_T w)
+{
+    INT_T half;
+    mask_t* m;
+    mask_t x;
+    mask_t y;
+
+    for (half = 0; half < 2; ++half)
+    {
+        m = mask + half * w;
+        x = m[MASK_WORD(a)] & MASK_BIT(a);
+        y = m[MASK_WORD(b)] & MASK_BIT(b);
+        m[MASK_WORD(a)] &= ~MASK_BIT(a);
+        m[MASK_WORD(b)] &= ~MASK_BIT(b);
+        if (x)
+            m[MASK_WORD(b)] |= MASK_BIT(b);
+        if (y)
+            m[MASK_WORD(a)] |= MASK_BIT(a);
+    }
+}
+
+/**
+ *  Sets the masks of a row made by {@code subEquations}. Only the columns
+ *  set in either of its operands, other than the pivot, can be non-zero.
+ *
+ *  @param out
+ *          The masks of the new row.
+ *  @param pos
+ *          The masks of the "lesser-than" operand.
+ *  @param neg
+ *          The masks of the "greater-than" operand.
+ *  @param eqn
+ *          The new row.
+ *  @param coeffPos
+ *          The pivot column.
+ *  @param w
+ *          The number of words in each mask.
+ */
+static void maskCombine(mask_t* out, const mask_t* pos, const mask_t* neg,
+        EQN_T** eqn, INT_T coeffPos, INT_T w)
+{
+    INT_T j;
+    INT_T k;
+    mask_t m;
+
+    memset(out, 0, sizeof(mask_t) * 2 * w);
+    for (j = 0; j < w; ++j)
+    {
+        m = pos[j] | pos[w + j] | neg[j] | neg[w + j];
+        if (j == MASK_WORD(coeffPos))
+        {
+            m &= ~MASK_BIT(coeffPos);
+        }
+        while (m)
+        {
+            k = j * MASK_BITS + __builtin_ctzll(m);
+            if (eqn[k]->nom > 0)
+                out[j] |= MASK_BIT(k);
+            else if (eqn[k]->nom < 0)
+                out[w + j] |= MASK_BIT(k);
+            m &= m - 1;
+        }
+    }
+}
+
+/**
+ *  Moves the variable among {@code 0 .. coeffPos} whose elimination adds
+ *  the fewest rows to column {@code coeffPos}, so it is eliminated next.
+ *  <p>
+ *  The number of positive and negative coefficients of every variable is
+ *  counted in one pass over the set bits of the masks. Eliminating a
+ *  variable replaces its {@code nPos + nNeg} rows by {@code nPos * nNeg}
+ *  rows, ties keep the current order.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param masks
+ *          The masks of the rows.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param coeffPos
+ *          The column to eliminate next.
+ *  @param w
+ *          The number of words in each mask.
+ */
+static void orderVariables(EQN_T*** eqns, mask_t* masks, ROW_T nEqn,
+        INT_T coeffPos, INT_T w)
+{
+    long* count = (long*) calloc(2 * (coeffPos + 1), sizeof(long));
+    long growth;
+    long best = 0;
+    INT_T var = coeffPos;
+    INT_T half;
+    INT_T j;
+    INT_T k;
+    ROW_T i;
+    mask_t m;
+    EQN_T* tmp;
+
+    if (count == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < nEqn; ++i)
+    {
+        for (half = 0; half < 2; ++half)
+        {
+            for (j = 0; j < w; ++j)
+            {
+                m = masks[(2 * i + half) * w + j];
+                while (m)
+                {
+                    count[2 * (j * MASK_BITS + __builtin_ctzll(m)) + half]++;
+                    m &= m - 1;
+                }
+            }
+        }
+    }
+
+    for (k = coeffPos; k >= 0; --k)
+    {
+        growth = count[2 * k] * count[2 * k + 1] - count[2 * k]
+            - count[2 * k + 1];
+        if (k == coeffPos || growth < best)
+        {
+            best = growth;
+            var = k;
+        }
+    }
+    free(count);
+
+    if (var == coeffPos)
+    {
+        return;
+    }
+    for (i = 0; i < nEqn; ++i)
+    {
+        tmp = eqns[i][var];
+        eqns[i][var] = eqns[i][coeffPos];
+        eqns[i][coeffPos] = tmp;
+        maskSwap(masks + 2 * w * i, var, coeffPos, w);
     }
-    printf("]\n");
 }
 
 /* =========== *
@@ -47,7 +228,7 @@ void printIntegerArray(INT_T* array, INT_T len, char* name)
  *  @return
  *          A pointer to the memory allocated for the system.
  */
-EQN_T*** newSystem(INT_T nEqn)
+EQN_T*** newSystem(ROW_T nEqn)
 {
     return (EQN_T***) malloc(sizeof(EQN_T**) * nEqn);
 }
@@ -89,7 +270,9 @@ EQN_T** copyEquation(EQN_T** eqn, INT_T nVar)
 }
 
 /**
- *  Copies an equation.
+ *  Drops the pivot column from a row that does not have it, in place: its
+ *  zero coefficient is freed and the constant moves into its slot. The row
+ *  keeps its array, one slot longer than it needs from now on.
  *  <p>
  *  @param eqn
  *          The equation to reduce.
@@ -97,21 +280,13 @@ EQN_T** copyEquation(EQN_T** eqn, INT_T nVar)
  *          The index of the coefficient most recently used to divide
  *          each equation.
  *  @return
- *          A new equation object containing the same coefficients
- *          as {@code eqn}.
+ *          The same equation, with {@code coeffPos + 1} coefficients.
  */
 EQN_T** reduceEquation(EQN_T** eqn, INT_T coeffPos)
 {
-    EQN_T** newEqn = newEquation(coeffPos);
-
-    INT_T i;
-    for (i = 0; i < coeffPos; ++i)
-    {
-        newEqn[i] = copyCoeff(eqn[i]);
-    }
-    newEqn[i] = copyCoeff(eqn[coeffPos + 1]);
-
-    return newEqn;
+    free(eqn[coeffPos]);
+    eqn[coeffPos] = eqn[coeffPos + 1];
+    return eqn;
 }
 
 /**
@@ -122,9 +297,9 @@ EQN_T** reduceEquation(EQN_T** eqn, INT_T coeffPos)
  *  @return
  *          A copy of the system.
  */
-EQN_T*** copySystem(EQN_T*** eqns, INT_T nEqn, INT_T nVar)
+EQN_T*** copySystem(EQN_T*** eqns, ROW_T nEqn, INT_T nVar)
 {
-    INT_T i;
+    ROW_T i;
     EQN_T*** newEqns = newSystem(nEqn);
     for (i = 0; i < nEqn; ++i)
     {
@@ -169,120 +344,339 @@ EQN_T** subEquations(EQN_T** pos, EQN_T** neg, INT_T coeffPos)
  *  Investigates if the system of relation-equations produced by the
  *  Fourier-Motzkin elimination has a solution or not.
  *  <p>
+ *  Called once only the first variable is left and the system has been
+ *  sorted by {@code partitionEquations}. A "greater-than" relation
+ *  {@code x + k >= 0} bounds {@code x} from below by {@code -k} and a
+ *  "lesser-than" relation {@code x + k <= 0} bounds it from above, while an
+ *  equation without {@code x} reads {@code k <= 0}.
  *
  *  @param eqns
  *          The system of equations.
- *  @param negIndices
- *          An array containing the indices of equations describing a
- *          "greater-than" relation.
- *  @param posIndices
- *          An array containing the indices of equations describing a
- *          "less-than" relation.
- *  @param nNeg
- *          The number of indices contained within {@code negIndices}.
  *  @param nPos
- *          The number of indices contained within {@code negIndices}.
- *  @param nEqn
- *          The number of equations in the equation system.
+ *          The number of "lesser-than" relations, at the front.
+ *  @param nZero
+ *          The number of equations without {@code x}, after those.
+ *  @param nNeg
+ *          The number of "greater-than" relations, after those.
  *  @return
  *          Zero if no solution could be found, a non-zero integer otherwise.
  */
-INT_T checkConstraints(EQN_T*** eqns, INT_T* negIndices,
-        INT_T* posIndices, INT_T nNeg, INT_T nPos, INT_T nEqn) {
-        
-        float qi = FLT_MIN;
-        float qj = FLT_MIN;
-        float cmp;
-        INT_T i;
-        
-        if (!nNeg || !nPos)
+INT_T checkConstraints(EQN_T*** eqns, ROW_T nPos, ROW_T nZero, ROW_T nNeg)
+{
+        EQN_T* lower = NULL;
+        EQN_T* upper = NULL;
+        EQN_T** eqn;
+        ROW_T i;
+
+        /* The largest lower bound has the smallest constant. */
+        for (i = nPos + nZero; i < nPos + nZero + nNeg; ++i)
         {
-            for (i = 0; i < nEqn; ++i)
+            eqn = eqns[i];
+            if (lower == NULL || lessThanCoeff(eqn[1], lower))
             {
-                if (!eqns[i][0]->nom) {
-                    return 0;
-                }
+                lower = eqn[1];
             }
-            return 1;
         }
 
-        for (i = 0; i < nNeg; ++i)
+        for (i = nPos; i < nPos + nZero; ++i)
         {
-            cmp = -evalCoeff(eqns[negIndices[i]][1]);
-            qj = qj < cmp ? cmp : qj;
+            if (eqns[i][1]->nom > 0)
+            {
+                return 0;
+            }
         }
+
+        /* The smallest upper bound has the largest constant. */
         for (i = 0; i < nPos; ++i)
         {
-            cmp = -evalCoeff(eqns[posIndices[i]][1]);
-            qi = qi < cmp ? cmp : qj;
+            eqn = eqns[i];
+            if (upper == NULL || lessThanCoeff(upper, eqn[1]))
+            {
+                upper = eqn[1];
+            }
         }
 
-        return qj != FLT_MIN && qj < qi;
+        return lower == NULL || upper == NULL || !lessThanCoeff(lower, upper);
 }
 
 /**
- *  Pairs equations describing "lesser-than" relations with equations describing
- *  "greater-than" relations, producing one new relation for each
- *  such pairing.
+ *  Divides a row by its coefficient of the pivot column, which becomes one.
+ *  Only the columns set in its masks are touched, and dividing by a
+ *  negative pivot swaps the masks.
+ *
+ *  @param eqn
+ *          The row, which holds the pivot.
+ *  @param mask
+ *          The masks of the row.
+ *  @param sign
+ *          The sign of the pivot.
+ *  @param coeffPos
+ *          The pivot column.
+ *  @param w
+ *          The number of words in each mask.
+ */
+static void divideEquation(EQN_T** eqn, mask_t* mask, INT_T sign,
+        INT_T coeffPos, INT_T w)
+{
+    EQN_T* div = eqn[coeffPos];
+    INT_T j;
+    mask_t m;
+
+    for (j = 0; j < w; ++j)
+    {
+        m = mask[j] | mask[w + j];
+        if (j == MASK_WORD(coeffPos))
+        {
+            m &= MASK_BIT(coeffPos) - 1;
+        }
+        while (m)
+        {
+            divCoeff(eqn[j * MASK_BITS + __builtin_ctzll(m)], div);
+            m &= m - 1;
+        }
+    }
+    divCoeff(eqn[coeffPos + 1], div);
+
+    if (sign < 0)
+    {
+        /* Dividing by a negative pivot flips every sign. */
+        for (j = 0; j < w; ++j)
+        {
+            m = mask[j];
+            mask[j] = mask[w + j];
+            mask[w + j] = m;
+        }
+    }
+    eqn[coeffPos]->nom = eqn[coeffPos]->denom = 1;
+}
+
+/**
+ *  Swaps two rows of a system, with their masks.
+ */
+static void swapRows(EQN_T*** eqns, mask_t* masks, ROW_T a, ROW_T b,
+        INT_T w)
+{
+    EQN_T** tmp = eqns[a];
+    mask_t* x = masks + 2 * w * a;
+    mask_t* y = masks + 2 * w * b;
+    mask_t m;
+    INT_T j;
+
+    eqns[a] = eqns[b];
+    eqns[b] = tmp;
+    for (j = 0; j < 2 * w; ++j)
+    {
+        m = x[j];
+        x[j] = y[j];
+        y[j] = m;
+    }
+}
+
+/**
+ *  Divides the rows holding the pivot by it and sorts the system by the
+ *  sign of the pivot, in one pass over the rows: "lesser-than" relations
+ *  first, then the rows without the pivot, then the "greater-than"
+ *  relations. Each row is divided as it is classified, and which class
+ *  a row is in is read from its masks.
  *  <p>
+ *  The three classes are kept apart like the Dutch national flag. Rows
+ *  before {@code lo} are "lesser-than" relations, those from {@code lo} to
+ *  {@code mid} lack the pivot and those from {@code hi} on are
+ *  "greater-than" relations. Only the rows from {@code mid} to {@code hi}
+ *  are left to look at, and a row taken from the end is looked at in turn.
  *
  *  @param eqns
- *          A pointer to the system of equations. When the function terminates,
- *          this pointer points to the new system of equations containing the
- *          pairings between "lesser-than" and "greater-than" relations.
- *  @param negIndices
- *          An array containing the indices of equations describing a
- *          "greater-than" relation.
- *  @param posIndices
- *          An array containing the indices of equations describing a
- *          "less-than" relation.
- *  @param nNeg
- *          The number of indices contained within {@code negIndices}.
- *  @param nPos
- *          The number of indices contained within {@code negIndices}.
+ *          The system of equations.
+ *  @param masks
+ *          The masks of the rows, updated to the signs after the division.
+ *  @param w
+ *          The number of words in each mask.
  *  @param nEqn
- *          A pointer to an integer containing the number of equations in the
- *          equation system. This value is updated within this function.
+ *          The number of equations.
  *  @param coeffPos
- *          The index of the coefficient most recently used to divide
- *          each equation.
+ *          The pivot column.
+ *  @param nPos
+ *          Set to the number of "lesser-than" relations.
+ *  @param nZero
+ *          Set to the number of rows without the pivot.
  */
-INT_T divideEquations(EQN_T*** eqns, INT_T* negIndices,
-        INT_T* posIndices, INT_T* nNeg, INT_T* nPos,
-        INT_T nEqn, INT_T coeffPos)
+static void partitionEquations(EQN_T*** eqns, mask_t* masks, INT_T w,
+        ROW_T nEqn, INT_T coeffPos, ROW_T* nPos, ROW_T* nZero)
 {
-    INT_T i;
-    INT_T j;
-    INT_T cPos = coeffPos + 1;
+    ROW_T lo = 0;
+    ROW_T mid = 0;
+    ROW_T hi = nEqn;
+    INT_T sign;
 
-    for (i = 0; i < nEqn; ++i)
+    while (mid < hi)
     {
-        EQN_T** eqn = eqns[i];
-        EQN_T* div = eqn[coeffPos];
-
-        if (!div->nom) {
-            posIndices[(*nPos)++] = i;
+        sign = maskSign(masks + 2 * w * mid, coeffPos, w);
+        if (!sign)
+        {
+            ++mid;
             continue;
         }
-
-        for (j = 0; j < coeffPos; ++j)
+        divideEquation(eqns[mid], masks + 2 * w * mid, sign, coeffPos, w);
+        if (sign > 0)
         {
-            divCoeff(eqns[i][j], div);
+            if (lo != mid)
+            {
+                swapRows(eqns, masks, lo, mid, w);
+            }
+            ++lo;
+            ++mid;
         }
-        divCoeff(eqns[i][cPos], div);
-        
-        if (div->nom < 0) {
-            negIndices[(*nNeg)++] = i;
-        } else {
-            posIndices[(*nPos)++] = i;
+        else if (--hi != mid)
+        {
+            swapRows(eqns, masks, mid, hi, w);
         }
-        eqns[i][coeffPos]->nom = eqns[i][coeffPos]->denom = 1;
     }
-    if (!(*nNeg) && !(*nPos))
+    *nPos = lo;
+    *nZero = mid - lo;
+}
+
+/**
+ *  Allocates the next level of a system sorted by
+ *  {@code partitionEquations} and moves the rows without the pivot, the
+ *  middle range, to its front with one copy of their pointers and one of
+ *  their masks. Those rows are still shared with the old system until
+ *  {@code levelEnd}.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param masks
+ *          The masks of the rows.
+ *  @param w
+ *          The number of words in each mask.
+ *  @param nPos
+ *          The number of "lesser-than" relations, at the front.
+ *  @param nZero
+ *          The number of rows without the pivot, after those.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param coeffPos
+ *          The pivot column.
+ *  @param budget
+ *          The budget of the solve, may be NULL.
+ *  @param newEqns
+ *          Set to the rows of the next level.
+ *  @param newMasks
+ *          Set to the masks of the next level.
+ *  @return
+ *          Non-zero if the budget ran out or the new level does not fit in
+ *          memory, in which case nothing is allocated.
+ */
+static INT_T levelStart(EQN_T*** eqns, mask_t* masks, INT_T w, ROW_T nPos,
+        ROW_T nZero, ROW_T nEqn, INT_T coeffPos, zmk_budget_t* budget,
+        EQN_T**** newEqns, mask_t** newMasks)
+{
+    ROW_T nNeg = nEqn - nPos - nZero;
+    size_t rowBytes = sizeof(EQN_T**)
+        + (coeffPos + 1) * (sizeof(EQN_T*) + sizeof(EQN_T))
+        + 2 * w * sizeof(mask_t);
+    ROW_T size;
+
+    /* A level whose size does not fit a size_t can not be held either. */
+    if (nNeg && nPos > ((size_t) -1 / rowBytes - nZero) / nNeg)
+    {
+        return 1;
+    }
+    size = nZero + nNeg * nPos;
+    if (budgetLevel(budget, nNeg * nPos, size * rowBytes))
     {
-        return -1;
+        return 1;
+    }
+
+    *newEqns = newSystem(size + 1);
+    *newMasks = (mask_t*) malloc(sizeof(mask_t) * 2 * w * (size + 1));
+    if (*newEqns == NULL || *newMasks == NULL)
+    {
+        free(*newEqns);
+        free(*newMasks);
+        return 1;
+    }
+    memcpy(*newEqns, eqns + nPos, sizeof(EQN_T**) * nZero);
+    memcpy(*newMasks, masks + 2 * w * nPos, sizeof(mask_t) * 2 * w * nZero);
+    return 0;
+}
+
+/**
+ *  Writes the combination of the "lesser-than" relation {@code i} and the
+ *  "greater-than" relation {@code j} as row {@code p} of the next level.
+ */
+static void levelPair(EQN_T*** newEqns, mask_t* newMasks, ROW_T p,
+        EQN_T*** eqns, mask_t* masks, ROW_T i, ROW_T j, INT_T coeffPos,
+        INT_T w)
+{
+    newEqns[p] = subEquations(eqns[i], eqns[j], coeffPos);
+    maskCombine(newMasks + 2 * w * p, masks + 2 * w * i, masks + 2 * w * j,
+        newEqns[p], coeffPos, w);
+}
+
+/**
+ *  Gives up on a level started by {@code levelStart} of which {@code p}
+ *  rows are written, leaving the old system as it was.
+ */
+static void levelAbort(EQN_T*** newEqns, mask_t* newMasks, ROW_T p,
+        ROW_T nZero, INT_T coeffPos)
+{
+    while (p > nZero)
+    {
+        freeEquation(newEqns[--p], coeffPos + 1);
     }
-    return (*nNeg) && (*nPos);
+    free(newEqns);
+    free(newMasks);
+}
+
+/**
+ *  Completes a level started by {@code levelStart} of which {@code p} rows
+ *  are written. The rows that were carried over lose the pivot column
+ *  through {@code reduceEquation}, those of the old system that held the
+ *  pivot are freed and the new level takes the place of the old.
+ *
+ *  @param eqns
+ *          A pointer to the system of equations, replaced by the new level.
+ *  @param masks
+ *          A pointer to the masks of the rows, replaced by those of the
+ *          new level.
+ *  @param newEqns
+ *          The rows of the new level.
+ *  @param newMasks
+ *          The masks of the new level.
+ *  @param p
+ *          The number of rows of the new level.
+ *  @param nPos
+ *          The number of "lesser-than" relations of the old system.
+ *  @param nZero
+ *          The number of rows without the pivot of the old system.
+ *  @param nEqn
+ *          A pointer to the number of equations, updated to {@code p}.
+ *  @param coeffPos
+ *          The pivot column.
+ */
+static void levelEnd(EQN_T**** eqns, mask_t** masks, EQN_T*** newEqns,
+        mask_t* newMasks, ROW_T p, ROW_T nPos, ROW_T nZero, ROW_T* nEqn,
+        INT_T coeffPos)
+{
+    ROW_T i;
+
+    for (i = 0; i < nZero; ++i)
+    {
+        reduceEquation(newEqns[i], coeffPos);
+    }
+    for (i = 0; i < nPos; ++i)
+    {
+        freeEquation((*eqns)[i], coeffPos + 2);
+    }
+    for (i = nPos + nZero; i < *nEqn; ++i)
+    {
+        freeEquation((*eqns)[i], coeffPos + 2);
+    }
+    free(*eqns);
+    free(*masks);
+    *nEqn = p;
+    *eqns = newEqns;
+    *masks = newMasks;
 }
 
 /**
@@ -290,64 +684,235 @@ INT_T divideEquations(EQN_T*** eqns, INT_T* negIndices,
  *  "greater-than" relations, producing one new relation for each
  *  such pairing.
  *  <p>
+ *  The system is sorted by {@code partitionEquations}, so each side of the
+ *  pairing is a range of rows. The pairs are taken in tiles of
+ *  {@code TILE_ROWS} rows from either side, so the rows of a tile stay in
+ *  cache while their combinations are made. Only those combinations are
+ *  written, the rows without the pivot are carried over by
+ *  {@code levelStart}.
  *
  *  @param eqns
  *          A pointer to the system of equations. When the function terminates,
  *          this pointer points to the new system of equations containing the
  *          pairings between "lesser-than" and "greater-than" relations.
- *  @param negIndices
- *          An array containing the indices of equations describing a
- *          "greater-than" relation.
- *  @param posIndices
- *          An array containing the indices of equations describing a
- *          "less-than" relation.
- *  @param nNeg
- *          The number of indices contained within {@code negIndices}.
+ *  @param masks
+ *          A pointer to the masks of the rows, replaced by the masks of the
+ *          new system.
+ *  @param w
+ *          The number of words in each mask.
  *  @param nPos
- *          The number of indices contained within {@code negIndices}.
+ *          The number of "lesser-than" relations, at the front.
+ *  @param nZero
+ *          The number of rows without the pivot, after those.
  *  @param nEqn
  *          A pointer to an integer containing the number of equations in the
  *          equation system. This value is updated within this function.
+ *  @param coeffPos
+ *          The pivot column.
+ *  @param budget
+ *          The budget of the solve, may be NULL.
+ *  @return
+ *          Non-zero if the budget ran out or the new level does not fit in
+ *          memory, in which case the system is left as it was.
  */
-void pairEquations(EQN_T**** eqns, INT_T* negIndices, INT_T* posIndices,
-    INT_T nNeg, INT_T nPos, INT_T* nEqn, INT_T coeffPos)
+INT_T pairEquations(EQN_T**** eqns, mask_t** masks, INT_T w, ROW_T nPos,
+    ROW_T nZero, ROW_T* nEqn, INT_T coeffPos, zmk_budget_t* budget)
 {
-    INT_T i;
-    INT_T j;
+    ROW_T i;
+    ROW_T j;
+    ROW_T ti;
+    ROW_T tj;
+    ROW_T iEnd;
+    ROW_T jEnd;
+    ROW_T tile = TILE_ROWS((coeffPos + 2) * (sizeof(EQN_T*) + sizeof(EQN_T))
+        + 2 * w * sizeof(mask_t));
+    ROW_T p = nZero;
+    EQN_T*** newEqns;
+    mask_t* newMasks;
 
-    INT_T p = 0;
-    
-    EQN_T*** newEqns = newSystem(!nNeg ? nPos : nNeg * nPos);
-    
-    for(i = 0; i < nPos; ++i)
+    if (levelStart(*eqns, *masks, w, nPos, nZero, *nEqn, coeffPos, budget,
+            &newEqns, &newMasks))
     {
+        return 1;
+    }
 
-        EQN_T** pos = (*eqns)[posIndices[i]];
-        if (pos[coeffPos]->nom == 0) {
-            newEqns[p++] = reduceEquation(pos, coeffPos);
-            continue;
-        }
-        
-        for (j = 0; j < nNeg; ++j)
+    for (ti = 0; ti < nPos; ti += tile)
+    {
+        iEnd = ti + tile < nPos ? ti + tile : nPos;
+        for (tj = nPos + nZero; tj < *nEqn; tj += tile)
         {
-            EQN_T** neg = (*eqns)[negIndices[j]];
-            if (neg[coeffPos]->nom == 0)
+            if (budgetCheck(budget))
             {
-                newEqns[p++] = reduceEquation(neg, coeffPos);
-                continue;
+                levelAbort(newEqns, newMasks, p, nZero, coeffPos);
+                return 1;
+            }
+            jEnd = tj + tile < *nEqn ? tj + tile : *nEqn;
+            for (i = ti; i < iEnd; ++i)
+            {
+                for (j = tj; j < jEnd; ++j)
+                {
+                    levelPair(newEqns, newMasks, p++, *eqns, *masks, i, j,
+                        coeffPos, w);
+                }
             }
-            
-            newEqns[p++] = subEquations(pos, neg, coeffPos);
         }
     }
-    freeSystem(*eqns, *nEqn, coeffPos + 2);
-    *nEqn = p;
-    *eqns = newEqns;
+
+    levelEnd(eqns, masks, newEqns, newMasks, p, nPos, nZero, nEqn, coeffPos);
+    return 0;
+}
+
+/**
+ *  Decides a system of equations as read by {@code parseSystem}.
+ *  <p>
+ *  A system that one of the points of {@code probeStart} satisfies is
+ *  decided right away, the others first go through {@code presolveSystem},
+ *  whose bounds on the variables give {@code probeBox} two more points to
+ *  try. What is left of the system is split by {@code zmkComponents} into
+ *  parts over disjoint variables, each decided by {@code zmkEliminate}.
+ *  The system is freed in all cases.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param stats
+ *          Filled in with what presolve removed, may be NULL.
+ *  @param budget
+ *          The budget of the solve, already started, may be NULL. Every
+ *          stage is charged for the rows it generates.
+ *  @return
+ *          Zero if no solution could be found, {@code ZMK_UNKNOWN} if the
+ *          coefficients of {@code zmkFast} overflowed, {@code ZMK_BUDGET}
+ *          if the budget ran out and a positive integer otherwise.
+ */
+INT_T zmkSolve(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, presolve_stats_t* stats,
+        zmk_budget_t* budget)
+{
+    return zmkSolveEq(eqns, nEqn, nVar, 0, stats, budget);
+}
+
+/**
+ *  Decides a system of equations as read by {@code parseSystemEq}, whose
+ *  first {@code nEq} rows are equalities, like {@code zmkSolve}.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param nEq
+ *          The number of equalities at the front of the system.
+ *  @param stats
+ *          Filled in with what presolve removed, may be NULL.
+ *  @param budget
+ *          The budget of the solve, already started, may be NULL.
+ *  @return
+ *          Zero if no solution could be found, {@code ZMK_UNKNOWN} if the
+ *          coefficients of {@code zmkFast} overflowed or memory ran out
+ *          while presolve substituted the equalities, {@code ZMK_BUDGET}
+ *          if the budget ran out and a positive integer otherwise.
+ */
+INT_T zmkSolveEq(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, ROW_T nEq,
+        presolve_stats_t* stats, zmk_budget_t* budget)
+{
+    probe_t probe;
+    INT_T res;
+
+    if (probeStart(&probe, eqns, nEqn, nVar, nEq) == ZMK_SAT)
+    {
+        if (stats != NULL)
+        {
+            memset(stats, 0, sizeof *stats);
+            stats->nIn = stats->nOut = nEqn;
+            stats->probed = 1;
+        }
+        freeSystem(eqns, nEqn, nVar + 1);
+        return ZMK_SAT;
+    }
+    res = presolveSystem(&eqns, &nEqn, &nVar, nEq, stats, probe.lo,
+        probe.up);
+    if (res == PRESOLVE_FAILED)
+    {
+        probeEnd(&probe);
+        freeSystem(eqns, nEqn, nVar + 1);
+        return ZMK_UNKNOWN;
+    }
+    if (res == ZMK_UNKNOWN && probeBox(&probe) == ZMK_SAT)
+    {
+        res = ZMK_SAT;
+        if (stats != NULL)
+        {
+            stats->probed = 1;
+        }
+    }
+    probeEnd(&probe);
+    if (res == ZMK_UNKNOWN)
+    {
+        return zmkComponents(eqns, nEqn, nVar, budget);
+    }
+    freeSystem(eqns, nEqn, nVar + 1);
+    return res;
+}
+
+/**
+ *  Decides a presolved system by handing it to the fixed-width kernel for
+ *  its number of variables, if there is one, then to {@code zmkSparse} if
+ *  few of its coefficients are non-zero, then to the floating-point filter
+ *  {@code zmkFloat} and only if none of them is certain of the answer to
+ *  {@code zmkFast}. The answer of zmkFast only stands if none of its
+ *  coefficients overflowed. The system is freed in all cases.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param budget
+ *          The budget of the solve, may be NULL.
+ *  @return
+ *          Zero if no solution could be found, {@code ZMK_UNKNOWN} if the
+ *          coefficients of {@code zmkFast} overflowed, {@code ZMK_BUDGET}
+ *          if the budget ran out and a positive integer otherwise.
+ */
+INT_T zmkEliminate(EQN_T*** eqns, ROW_T nEqn, INT_T nVar,
+        zmk_budget_t* budget)
+{
+    INT_T res = zmkFixed(eqns, nEqn, nVar, budget);
+
+    if (res == ZMK_UNKNOWN
+            && systemDensity(eqns, nEqn, nVar) <= SPARSE_DENSITY)
+    {
+        res = zmkSparse(eqns, nEqn, nVar, budget);
+    }
+    if (res == ZMK_UNKNOWN)
+    {
+        res = zmkFloat(eqns, nEqn, nVar, budget);
+    }
+    if (res != ZMK_UNKNOWN)
+    {
+        freeSystem(eqns, nEqn, nVar + 1);
+        return res;
+    }
+
+    /* An overflow left over from the stages above is not zmkFast's. */
+    coeffOverflowed();
+    return zmkFast(eqns, nEqn, nVar, budget);
 }
 
 /**
  *  Performs Fourier-Motzkin elimination on a given system of equations.
  *  <p>
+ *  The sign masks of the rows decide which rows hold the pivot and which
+ *  variable is eliminated next, without reading the coefficients.
+ *  Opposite rows with matching constants that a level produces are
+ *  substituted away by {@code implicitEqualities} before the next one.
+ *  A level in which a coefficient overflowed, as {@code coeffOverflowed}
+ *  tells, ends the solve, since its rows no longer mean anything.
  *
  *  @param eqns
  *          The system of equations.
@@ -355,59 +920,390 @@ void pairEquations(EQN_T**** eqns, INT_T* negIndices, INT_T* posIndices,
  *          The number of equations.
  *  @param nVar
  *          The number of variables in each equation.
+ *  @param budget
+ *          The budget of the solve, may be NULL.
  *  @return
- *          Zero if no solution could be found, a non-zero integer otherwise.
+ *          Zero if no solution could be found, {@code ZMK_UNKNOWN} if a
+ *          coefficient overflowed, {@code ZMK_BUDGET} if the budget ran out
+ *          or a level did not fit in memory and a positive integer
+ *          otherwise.
  */
-INT_T zmkFast(EQN_T*** eqns, INT_T nEqn, INT_T nVar)
+INT_T zmkFast(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, zmk_budget_t* budget)
 {
-    INT_T i;
-    INT_T n = nEqn;
-    INT_T currVar;
-    INT_T nNeg = 0;
-    INT_T nPos = 0;
+    ROW_T i;
+    ROW_T j;
+    ROW_T n = nEqn;
+    INT_T k;
+    INT_T currVar = nVar - 1;
+    ROW_T nNeg = 0;
+    ROW_T nPos = 0;
+    ROW_T nZero = 0;
     INT_T res = 0;
-    INT_T* negIndices;
-    INT_T* posIndices;
+    INT_T w = MASK_WORDS(nVar);
+    short overflow = 0;
+    mask_t* masks = (mask_t*) malloc(sizeof(mask_t) * 2 * w * (n + 1));
 
-    for (i = 0; i < nVar; ++i)
+    for (i = 0; i < n; ++i)
+    {
+        maskEquation(masks + 2 * w * i, eqns[i], nVar, w);
+    }
+
+    for (k = 0; k < nVar; ++k)
     {
-        nNeg = 0;
-        nPos = 0;
-        currVar = nVar - i - 1;
+        currVar = nVar - k - 1;
+
+        if (overflow)
+        {
+            res = ZMK_UNKNOWN;
+            break;
+        }
         
-        negIndices = (INT_T*) malloc(sizeof(INT_T) * n);
-        posIndices = (INT_T*) malloc(sizeof(INT_T) * n);
+        if (currVar > 0)
+        {
+            orderVariables(eqns, masks, n, currVar, w);
+        }
         
-        divideEquations(eqns, negIndices, posIndices, &nNeg, &nPos,
-                n, currVar);
+        partitionEquations(eqns, masks, w, n, currVar, &nPos, &nZero);
+        nNeg = n - nPos - nZero;
         
         if (currVar == 0)
         {
             break;
         }
         
-        pairEquations(&eqns, negIndices, posIndices, nNeg, nPos,
-            &n, currVar);
-        
-        free(negIndices);
-        free(posIndices);
+        if (pairEquations(&eqns, &masks, w, nPos, nZero, &n, currVar,
+                budget))
+        {
+            res = ZMK_BUDGET;
+            break;
+        }
+
+        /* Equalities the level turned up are substituted away. */
+        overflow = coeffOverflowed();
+        if (!overflow && currVar > 1
+                && implicitEqualities(eqns, &n, currVar))
+        {
+            for (j = 0; j < n; ++j)
+            {
+                maskEquation(masks + 2 * w * j, eqns[j], currVar, w);
+            }
+        }
     }
 
-    res = checkConstraints(eqns, negIndices, posIndices, nNeg,
-            nPos, n);
+    if (res != ZMK_BUDGET && res != ZMK_UNKNOWN)
+    {
+        res = coeffOverflowed() ? ZMK_UNKNOWN
+            : checkConstraints(eqns, nPos, nZero, nNeg);
+    }
     
     freeSystem(eqns, n, currVar + 2);
-    free(negIndices);
-    free(posIndices);
+    free(masks);
     
     return res;
 }
 
+/* ======= *
+ *  Steps.  *
+ * ======= */
+
+/*
+ *  A solve run a bounded amount of work at a time by zmkStep. Everything
+ *  zmkFast keeps on its stack between levels is kept here, as is the level
+ *  being written and the next pair of rows to combine into it, so that a
+ *  step can stop after any pair. Pairs are taken tile by tile as in
+ *  pairEquations: (ti, tj) is the tile and (i, j) the pair within it.
+ */
+enum { STEP_LEVEL, STEP_PAIR, STEP_DONE };
+
+struct zmk_step {
+    EQN_T*** eqns;          /* The current level. */
+    mask_t* masks;
+    ROW_T n;
+    INT_T w;
+    INT_T currVar;          /* The pivot column of the current level. */
+    ROW_T nPos;
+    ROW_T nZero;
+    EQN_T*** next;          /* The level being written, or NULL. */
+    mask_t* nextMasks;
+    ROW_T p;                /* The rows of it written so far. */
+    ROW_T tile;
+    ROW_T ti;
+    ROW_T tj;
+    ROW_T i;
+    ROW_T j;
+    int state;
+    INT_T res;
+};
+
+/**
+ *  Ends a solve with a result, freeing whatever of the system is left.
+ */
+static void stepFinish(zmk_step_t* s, INT_T res)
+{
+    if (s->next != NULL)
+    {
+        levelAbort(s->next, s->nextMasks, s->p, s->nZero, s->currVar);
+        s->next = NULL;
+    }
+    if (s->eqns != NULL)
+    {
+        freeSystem(s->eqns, s->n, s->currVar + 2);
+        s->eqns = NULL;
+    }
+    free(s->masks);
+    s->masks = NULL;
+    s->res = res;
+    s->state = STEP_DONE;
+}
+
+/**
+ *  Sorts the current level by the sign of the next pivot, as zmkFast does,
+ *  and starts writing the next level, or decides the system if only the
+ *  first variable is left.
+ *
+ *  @return
+ *          The work done, one unit for every row of the level.
+ */
+static size_t stepLevel(zmk_step_t* s)
+{
+    size_t done = s->n + 1;
+
+    if (s->currVar < 0)
+    {
+        stepFinish(s, checkConstraints(s->eqns, 0, 0, 0));
+        return done;
+    }
+    if (s->currVar > 0)
+    {
+        orderVariables(s->eqns, s->masks, s->n, s->currVar, s->w);
+    }
+    partitionEquations(s->eqns, s->masks, s->w, s->n, s->currVar, &s->nPos,
+        &s->nZero);
+    if (s->currVar == 0)
+    {
+        stepFinish(s, checkConstraints(s->eqns, s->nPos, s->nZero,
+            s->n - s->nPos - s->nZero));
+        return done;
+    }
+    if (levelStart(s->eqns, s->masks, s->w, s->nPos, s->nZero, s->n,
+            s->currVar, NULL, &s->next, &s->nextMasks))
+    {
+        s->next = NULL;
+        stepFinish(s, ZMK_BUDGET);
+        return done;
+    }
+    s->p = s->nZero;
+    s->tile = TILE_ROWS((s->currVar + 2) * (sizeof(EQN_T*) + sizeof(EQN_T))
+        + 2 * s->w * sizeof(mask_t));
+    s->ti = s->i = 0;
+    s->tj = s->j = s->nPos + s->nZero;
+    s->state = STEP_PAIR;
+    return done;
+}
+
+/**
+ *  Combines at most {@code work} pairs of rows into the level being
+ *  written, in the order of pairEquations, and completes the level once
+ *  the last pair is combined.
+ *
+ *  @return
+ *          The work done, one unit for every pair and, if the level was
+ *          completed, one for every row of the new level.
+ */
+static size_t stepPairs(zmk_step_t* s, size_t work)
+{
+    ROW_T negStart = s->nPos + s->nZero;
+    ROW_T iEnd;
+    ROW_T jEnd;
+    ROW_T k;
+    size_t done = 0;
+
+    while (done < work && s->ti < s->nPos && negStart < s->n)
+    {
+        iEnd = s->ti + s->tile < s->nPos ? s->ti + s->tile : s->nPos;
+        jEnd = s->tj + s->tile < s->n ? s->tj + s->tile : s->n;
+        levelPair(s->next, s->nextMasks, s->p++, s->eqns, s->masks, s->i,
+            s->j, s->currVar, s->w);
+        ++done;
+
+        if (++s->j < jEnd)
+        {
+            continue;
+        }
+        s->j = s->tj;
+        if (++s->i < iEnd)
+        {
+            continue;
+        }
+        /* The tile is done, the next one is to the right or below. */
+        s->tj += s->tile;
+        if (s->tj >= s->n)
+        {
+            s->tj = negStart;
+            s->ti += s->tile;
+        }
+        s->i = s->ti;
+        s->j = s->tj;
+    }
+    if (s->ti < s->nPos && negStart < s->n)
+    {
+        return done;
+    }
+
+    levelEnd(&s->eqns, &s->masks, s->next, s->nextMasks, s->p, s->nPos,
+        s->nZero, &s->n, s->currVar);
+    s->next = NULL;
+    s->nextMasks = NULL;
+    if (s->currVar > 1 && implicitEqualities(s->eqns, &s->n, s->currVar))
+    {
+        for (k = 0; k < s->n; ++k)
+        {
+            maskEquation(s->masks + 2 * s->w * k, s->eqns[k], s->currVar,
+                s->w);
+        }
+    }
+    s->currVar--;
+    s->state = STEP_LEVEL;
+    return done + s->n;
+}
+
+/**
+ *  Starts a solve of a system as read by {@code parseSystemEq}, to be run
+ *  by {@code zmkStep}. The system goes through {@code presolveSystem} at
+ *  once, and what is left of it is eliminated like {@code zmkFast} does,
+ *  without the other stages in front of it. The solve owns the system from
+ *  now on.
+ *  <p>
+ *  The presolve is not sliced into steps: this call takes time in the size
+ *  of the system, however little work the steps are given.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param nEq
+ *          The number of equalities at the front of the system.
+ *  @param stats
+ *          Filled in with what presolve removed, may be NULL.
+ *  @return
+ *          The solve, NULL if memory ran out, in which case the system is
+ *          freed.
+ */
+zmk_step_t* zmkStepStart(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, ROW_T nEq,
+        presolve_stats_t* stats)
+{
+    zmk_step_t* s = (zmk_step_t*) calloc(1, sizeof(zmk_step_t));
+    INT_T res;
+    ROW_T i;
+
+    if (s == NULL)
+    {
+        freeSystem(eqns, nEqn, nVar + 1);
+        return NULL;
+    }
+    coeffOverflowed();
+    res = presolveSystem(&eqns, &nEqn, &nVar, nEq, stats, NULL, NULL);
+    s->eqns = eqns;
+    s->n = nEqn;
+    s->currVar = nVar - 1;
+    s->w = MASK_WORDS(nVar);
+    s->res = ZMK_PENDING;
+    s->state = STEP_LEVEL;
+    if (coeffOverflowed() || res == PRESOLVE_FAILED)
+    {
+        stepFinish(s, ZMK_UNKNOWN);
+        return s;
+    }
+    if (res != ZMK_UNKNOWN)
+    {
+        stepFinish(s, res);
+        return s;
+    }
+
+    s->masks = (mask_t*) malloc(sizeof(mask_t) * 2 * s->w * (nEqn + 1));
+    if (s->masks == NULL)
+    {
+        stepFinish(s, ZMK_BUDGET);
+        return s;
+    }
+    for (i = 0; i < nEqn; ++i)
+    {
+        maskEquation(s->masks + 2 * s->w * i, eqns[i], nVar, s->w);
+    }
+    return s;
+}
+
+/**
+ *  Runs a solve for about {@code work} units of work: a unit is a pair of
+ *  rows combined or a row sorted or carried to the next level. Sorting a
+ *  level is done in one go, however many rows it has, so a step may run
+ *  over by the size of one level.
+ *  <p>
+ *  The arithmetic is that of {@code zmkFast}. A step in which a coefficient
+ *  overflowed ends the solve with {@code ZMK_UNKNOWN}, for the caller to
+ *  decide the system another way.
+ *
+ *  @param s
+ *          The solve.
+ *  @param work
+ *          The work to do at most, give or take a level.
+ *  @return
+ *          {@code ZMK_PENDING} if there is work left, otherwise the result:
+ *          {@code ZMK_SAT}, {@code ZMK_UNSAT}, {@code ZMK_UNKNOWN} if the
+ *          coefficients overflowed or {@code ZMK_BUDGET} if a level did not
+ *          fit in memory. Once there is a result, it is all further steps
+ *          return.
+ */
+INT_T zmkStep(zmk_step_t* s, size_t work)
+{
+    size_t done = 0;
+
+    if (s->state == STEP_DONE)
+    {
+        return s->res;
+    }
+    coeffOverflowed();
+    while (s->state != STEP_DONE && done < work)
+    {
+        if (s->state == STEP_LEVEL)
+        {
+            done += stepLevel(s);
+        }
+        else
+        {
+            done += stepPairs(s, work - done);
+        }
+    }
+    if (coeffOverflowed())
+    {
+        stepFinish(s, ZMK_UNKNOWN);
+    }
+    return s->res;
+}
+
+/**
+ *  Frees a solve, done or not.
+ *
+ *  @param s
+ *          The solve, may be NULL.
+ */
+void zmkStepFree(zmk_step_t* s)
+{
+    if (s == NULL)
+    {
+        return;
+    }
+    stepFinish(s, s->res);
+    free(s);
+}
+
 /**
  *  Performs Fourier-Motzkin elimination on a given system of equations.
  *  <p>
  *  This function includes debugging prints to the standard output, but is
- *  otherwise identical to {@code zmkFast}.
+ *  otherwise identical to {@code zmkFast}, without the budget.
  *
  *  @param eqns
  *          The system of equations.
@@ -416,37 +1312,53 @@ INT_T zmkFast(EQN_T*** eqns, INT_T nEqn, INT_T nVar)
  *  @param nVar
  *          The number of variables in each equation.
  *  @return
- *          Zero if no solution could be found, a non-zero integer otherwise.
+ *          Zero if no solution could be found, {@code ZMK_UNKNOWN} if a
+ *          coefficient overflowed and a positive integer otherwise.
  */
-INT_T zmkFastDebug(EQN_T*** eqns, INT_T nEqn, INT_T nVar)
+INT_T zmkFastDebug(EQN_T*** eqns, ROW_T nEqn, INT_T nVar)
 {
     //EQN_T*** eqns = copySystem(origEqns, nEqn, nVar);
     printf("Received equations:\n");
     printSystem(eqns, nEqn, nVar + 1);
-    INT_T i;
-    INT_T n = nEqn;
-    INT_T currVar;
-    INT_T nNeg = 0;
-    INT_T nPos = 0;
+    ROW_T i;
+    ROW_T n = nEqn;
+    INT_T k;
+    INT_T currVar = nVar - 1;
+    ROW_T nNeg = 0;
+    ROW_T nPos = 0;
+    ROW_T nZero = 0;
     INT_T res = 0;
-    INT_T* negIndices;
-    INT_T* posIndices;
+    INT_T w = MASK_WORDS(nVar);
+    short overflow = 0;
+    mask_t* masks = (mask_t*) malloc(sizeof(mask_t) * 2 * w * (n + 1));
 
-    for (i = 0; i < nVar; ++i)
+    coeffOverflowed();
+    for (i = 0; i < n; ++i)
     {
-        nNeg = 0;
-        nPos = 0;
-        currVar = nVar - i - 1;
+        maskEquation(masks + 2 * w * i, eqns[i], nVar, w);
+    }
+
+    for (k = 0; k < nVar; ++k)
+    {
+        currVar = nVar - k - 1;
+
+        if (overflow)
+        {
+            res = ZMK_UNKNOWN;
+            break;
+        }
         
-        negIndices = (INT_T*) malloc(sizeof(INT_T) * n);
-        posIndices = (INT_T*) malloc(sizeof(INT_T) * n);
+        if (currVar > 0)
+        {
+            orderVariables(eqns, masks, n, currVar, w);
+        }
         
-        printf("Dividing for coeff %hu\n", currVar);
-        divideEquations(eqns, negIndices, posIndices, &nNeg, &nPos,
-                n, currVar);
+        printf("Dividing for coeff %d\n", (int) currVar);
+        partitionEquations(eqns, masks, w, n, currVar, &nPos, &nZero);
+        nNeg = n - nPos - nZero;
 
-        printIntegerArray(negIndices, nNeg, "Negative");
-        printIntegerArray(posIndices, nPos, "Positive");
+        printf("Positive = %zu, without = %zu, negative = %zu\n", nPos,
+            nZero, nNeg);
         printSystem(eqns, n, currVar + 2);
         
         if (currVar == 0)
@@ -454,30 +1366,30 @@ INT_T zmkFastDebug(EQN_T*** eqns, INT_T nEqn, INT_T nVar)
             break;
         }
         
-        pairEquations(&eqns, negIndices, posIndices, nNeg, nPos,
-            &n, currVar);
-        
-        free(negIndices);
-        free(posIndices);
+        pairEquations(&eqns, &masks, w, nPos, nZero, &n, currVar, NULL);
         
         printSystem(eqns, n, currVar + 1);
-        printf("Current number of equations: %hi\n", n);
+        printf("Current number of equations: %zu\n", n);
+        overflow = coeffOverflowed();
     }
 
-    res = checkConstraints(eqns, negIndices, posIndices, nNeg,
-            nPos, n);
+    if (res != ZMK_UNKNOWN)
+    {
+        res = coeffOverflowed() ? ZMK_UNKNOWN
+            : checkConstraints(eqns, nPos, nZero, nNeg);
+    }
 
-    
-    if (res)
+    if (res == ZMK_UNKNOWN)
     {
+        printf("Coefficients overflowed.\n");
+    } else if (res) {
         printf("Solution found.\n\n");
     } else {
         printf("No solution.\n");
     }
     
     freeSystem(eqns, n, currVar + 2);
-    free(negIndices);
-    free(posIndices);
+    free(masks);
     
     return res;
 }
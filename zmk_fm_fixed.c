@@ -0,0 +1,374 @@
+#ifndef ZMK_FM_FIXED_C
+#define ZMK_FM_FIXED_C
+
+#include "coeff.h"
+#include "util.h"
+#include "zmk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ *  Rows of the fixed kernels are integers padded to a width that fills one or
+ *  two vector registers. Columns 0 .. N - 1 hold the coefficients, column N
+ *  the constant and the rest is zero. Eliminated columns are left in place as
+ *  zeros, so every loop below runs over the same compile-time width.
+ */
+#define FIXED_T         int
+#define FIXED_MAX_VAR   (8)
+#define FIXED_MAX_W     (16)
+
+#define FIXED_INLINE    static inline __attribute__((always_inline))
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Combines a "lesser-than" row with a "greater-than" row on column
+ *  {@code k}, producing a row in which column {@code k} is zero.
+ *  <p>
+ *  Both rows are scaled by the other's coefficient, which unlike dividing
+ *  keeps the arithmetic in integers, and the result is divided by the gcd of
+ *  all its entries.
+ *
+ *  @param out
+ *          The row to write.
+ *  @param pos
+ *          A row with a positive coefficient in column {@code k}.
+ *  @param neg
+ *          A row with a negative coefficient in column {@code k}.
+ *  @return
+ *          Non-zero if the result does not fit a {@code FIXED_T}.
+ */
+FIXED_INLINE int fixedCombine(FIXED_T* out, const FIXED_T* pos,
+        const FIXED_T* neg, int k, int W)
+{
+    long long tmp[FIXED_MAX_W];
+    long long pk = pos[k];
+    long long nk = -(long long) neg[k];
+    long long g = 0;
+    int overflow = 0;
+    int j;
+
+#pragma GCC unroll 16
+    for (j = 0; j < W; ++j)
+    {
+        tmp[j] = pos[j] * nk + neg[j] * pk;
+    }
+    for (j = 0; j < W && g != 1; ++j)
+    {
+        g = gcdLong(tmp[j] < 0 ? -tmp[j] : tmp[j], g);
+    }
+    if (g > 1)
+    {
+#pragma GCC unroll 16
+        for (j = 0; j < W; ++j)
+        {
+            tmp[j] /= g;
+        }
+    }
+#pragma GCC unroll 16
+    for (j = 0; j < W; ++j)
+    {
+        out[j] = (FIXED_T) tmp[j];
+        overflow |= out[j] != tmp[j];
+    }
+    return overflow;
+}
+
+/**
+ *  Decides a system once only the first variable is left. Rows read
+ *  {@code a x + c <= 0}, a negative {@code a} bounds {@code x} from below by
+ *  {@code c / -a} and a positive one from above by {@code -c / a}.
+ */
+FIXED_INLINE INT_T fixedCheck(const FIXED_T* rows, size_t n, int N, int W)
+{
+    long long loNom = 0;
+    long long loDen = 0;
+    long long upNom = 0;
+    long long upDen = 0;
+    const FIXED_T* row;
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        row = rows + i * W;
+        if (row[0] < 0)
+        {
+            if (!loDen || (long long) row[N] * loDen > loNom * -row[0])
+            {
+                loNom = row[N];
+                loDen = -row[0];
+            }
+        } else if (row[0] > 0) {
+            if (!upDen || (long long) -row[N] * upDen < upNom * row[0])
+            {
+                upNom = -row[N];
+                upDen = row[0];
+            }
+        } else if (row[N] > 0) {
+            return ZMK_UNSAT;
+        }
+    }
+
+    if (!loDen || !upDen)
+    {
+        return ZMK_SAT;
+    }
+    return loNom * upDen <= upNom * loDen ? ZMK_SAT : ZMK_UNSAT;
+}
+
+/**
+ *  Moves the rows with a negative coefficient in column {@code k} to the
+ *  front, followed by those with a positive one and then the rest.
+ */
+FIXED_INLINE void fixedPartition(FIXED_T* rows, size_t n, int k, int W,
+        size_t* nNeg, size_t* nPos)
+{
+    FIXED_T tmp[FIXED_MAX_W];
+    FIXED_T* a;
+    FIXED_T* b;
+    size_t lo = 0;
+    size_t hi = n;
+    size_t i;
+
+    for (i = 0; i < hi; )
+    {
+        a = rows + i * W;
+        if (a[k] < 0)
+        {
+            b = rows + lo++ * W;
+            ++i;
+        } else if (!a[k]) {
+            b = rows + --hi * W;
+        } else {
+            ++i;
+            continue;
+        }
+        if (a != b)
+        {
+            memcpy(tmp, a, sizeof(FIXED_T) * W);
+            memcpy(a, b, sizeof(FIXED_T) * W);
+            memcpy(b, tmp, sizeof(FIXED_T) * W);
+        }
+    }
+    *nNeg = lo;
+    *nPos = hi - lo;
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Performs Fourier-Motzkin elimination on rows of a compile-time width.
+ *  <p>
+ *  Every variant generated below calls this with constant {@code N} and
+ *  {@code W}, so the compiler specializes and unrolls it for each of them.
+ *  <p>
+ *  The rows of a level lie partitioned into negative, positive and zero
+ *  blocks, and the product of the first two is generated in tiles of
+ *  {@code TILE_ROWS} rows from each, so both stay in cache while the
+ *  combinations of a tile are written out in order.
+ *
+ *  @param rows
+ *          The rows, which are freed by this function.
+ *  @param n
+ *          The number of rows.
+ *  @param budget
+ *          The budget of the solve, may be NULL.
+ *  @return
+ *          {@code ZMK_SAT}, {@code ZMK_UNSAT}, {@code ZMK_UNKNOWN} if a
+ *          coefficient overflowed or memory ran out or {@code ZMK_BUDGET}.
+ */
+FIXED_INLINE INT_T fixedEliminate(FIXED_T* rows, size_t n, int N, int W,
+        zmk_budget_t* budget)
+{
+    FIXED_T* next;
+    FIXED_T* out;
+    const FIXED_T* pos;
+    const FIXED_T* neg;
+    size_t nNeg;
+    size_t nPos;
+    size_t nZero;
+    size_t tile = TILE_ROWS(sizeof(FIXED_T) * W);
+    size_t ti;
+    size_t tj;
+    size_t iEnd;
+    size_t jEnd;
+    size_t i;
+    size_t j;
+    int overflow = 0;
+    int k;
+    INT_T res;
+
+    for (k = N - 1; k > 0 && n; --k)
+    {
+        fixedPartition(rows, n, k, W, &nNeg, &nPos);
+        nZero = n - nNeg - nPos;
+
+        /* Rows bounding x_k from one side only are always satisfiable. */
+        if (!nNeg || !nPos)
+        {
+            memmove(rows, rows + (nNeg + nPos) * W,
+                sizeof(FIXED_T) * W * nZero);
+            n = nZero;
+            continue;
+        }
+
+        if (nPos > ((size_t) -1 / sizeof(FIXED_T) / W - nZero) / nNeg)
+        {
+            free(rows);
+            return ZMK_UNKNOWN;
+        }
+        if (budgetLevel(budget, nNeg * nPos,
+                sizeof(FIXED_T) * W * (nZero + nNeg * nPos)))
+        {
+            free(rows);
+            return ZMK_BUDGET;
+        }
+        next = (FIXED_T*) malloc(sizeof(FIXED_T) * W * (nZero + nNeg * nPos));
+        if (next == NULL)
+        {
+            free(rows);
+            return ZMK_UNKNOWN;
+        }
+
+        memcpy(next, rows + (nNeg + nPos) * W, sizeof(FIXED_T) * W * nZero);
+        out = next + nZero * W;
+        for (ti = 0; ti < nPos; ti += tile)
+        {
+            iEnd = ti + tile < nPos ? ti + tile : nPos;
+            for (tj = 0; tj < nNeg; tj += tile)
+            {
+                if (budgetCheck(budget))
+                {
+                    free(next);
+                    free(rows);
+                    return ZMK_BUDGET;
+                }
+                jEnd = tj + tile < nNeg ? tj + tile : nNeg;
+                for (i = ti; i < iEnd; ++i)
+                {
+                    pos = rows + (nNeg + i) * W;
+                    for (j = tj; j < jEnd; ++j)
+                    {
+                        neg = rows + j * W;
+                        overflow |= fixedCombine(out, pos, neg, k, W);
+                        out += W;
+                    }
+                }
+            }
+        }
+
+        free(rows);
+        rows = next;
+        n = nZero + nNeg * nPos;
+        if (overflow)
+        {
+            free(rows);
+            return ZMK_UNKNOWN;
+        }
+    }
+
+    res = fixedCheck(rows, n, N, W);
+    free(rows);
+    return res;
+}
+
+#define FIXED_KERNEL(N, W)                                                  \
+    static INT_T zmkFixed##N(FIXED_T* rows, size_t n,                       \
+            zmk_budget_t* budget)                                           \
+    {                                                                       \
+        return fixedEliminate(rows, n, N, W, budget);                       \
+    }
+
+FIXED_KERNEL(1, 4)
+FIXED_KERNEL(2, 4)
+FIXED_KERNEL(3, 4)
+FIXED_KERNEL(4, 8)
+FIXED_KERNEL(5, 8)
+FIXED_KERNEL(6, 8)
+FIXED_KERNEL(7, 8)
+FIXED_KERNEL(8, 16)
+
+static const struct fixed_kernel {
+    int W;
+    INT_T (*func)(FIXED_T*, size_t, zmk_budget_t*);
+} fixedKernels[FIXED_MAX_VAR + 1] = {
+    { 0, NULL },
+    { 4, zmkFixed1 },
+    { 4, zmkFixed2 },
+    { 4, zmkFixed3 },
+    { 8, zmkFixed4 },
+    { 8, zmkFixed5 },
+    { 8, zmkFixed6 },
+    { 8, zmkFixed7 },
+    { 16, zmkFixed8 },
+};
+
+/**
+ *  Decides a system with at most {@code FIXED_MAX_VAR} variables with the
+ *  kernel specialized for its number of variables.
+ *  <p>
+ *  Each row is scaled to integers by {@code integerEquation}. The system
+ *  itself is left untouched.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param budget
+ *          The budget of the solve, may be NULL.
+ *  @return
+ *          {@code ZMK_SAT} or {@code ZMK_UNSAT}, {@code ZMK_UNKNOWN} if
+ *          there is no kernel for {@code nVar} or the integers overflowed,
+ *          or {@code ZMK_BUDGET}.
+ */
+INT_T zmkFixed(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, zmk_budget_t* budget)
+{
+    FIXED_T* rows;
+    FIXED_T* row;
+    long long v[FIXED_MAX_VAR + 1];
+    int W;
+    ROW_T i;
+    INT_T j;
+
+    if (nVar < 1 || nVar > FIXED_MAX_VAR || nEqn < 1)
+    {
+        return ZMK_UNKNOWN;
+    }
+    W = fixedKernels[nVar].W;
+
+    rows = (FIXED_T*) calloc(nEqn * W, sizeof(FIXED_T));
+    if (rows == NULL)
+    {
+        return ZMK_UNKNOWN;
+    }
+
+    for (i = 0; i < nEqn; ++i)
+    {
+        row = rows + i * W;
+        if (!integerEquation(eqns[i], nVar, v))
+        {
+            free(rows);
+            return ZMK_UNKNOWN;
+        }
+        for (j = 0; j <= nVar; ++j)
+        {
+            row[j] = (FIXED_T) v[j];
+            if (row[j] != v[j])
+            {
+                free(rows);
+                return ZMK_UNKNOWN;
+            }
+        }
+    }
+
+    return fixedKernels[nVar].func(rows, nEqn, budget);
+}
+
+#endif
@@ -0,0 +1,453 @@
+#ifndef ZMK_FM_FLOAT_C
+#define ZMK_FM_FLOAT_C
+
+#include "coeff.h"
+#include "util.h"
+#include "zmk.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ *  Every entry of a row is kept as a midpoint and a radius, and the exact
+ *  value of the entry, for the same combination of input rows, is known to
+ *  lie within the radius of the midpoint. Rows made of integers below
+ *  FLOAT_EXACT are combined exactly and keep a zero radius. Once a row
+ *  grows past FLOAT_RESCALE it is scaled down by a power of two, which is
+ *  exact as well.
+ */
+#define FLOAT_EXACT     (4503599627370496.0)    /* 2^52 */
+#define FLOAT_RESCALE   (0x1p256)
+#define FLOAT_U         (DBL_EPSILON / 2)
+#define FLOAT_GAMMA2    (2 * FLOAT_U / (1 - 2 * FLOAT_U))
+
+#define DOWN(x)         nextafter((x), -HUGE_VAL)
+#define UP(x)           nextafter((x), HUGE_VAL)
+
+/**
+ *  Bookkeeping for one row.
+ */
+typedef struct float_row {
+    double max;     /* The largest magnitude of a midpoint in the row. */
+    int exact;      /* Non-zero while the row holds small integers only. */
+} float_row_t;
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Returns the sign of an entry if it is certain: 1 or -1, 0 if the entry is
+ *  exactly zero and 2 if its sign can not be told.
+ */
+static int floatSign(double v, double r)
+{
+    if (v == 0 && r == 0)
+        return 0;
+    else if (DOWN(v - r) > 0)
+        return 1;
+    else if (UP(v + r) < 0)
+        return -1;
+    else
+        return 2;
+}
+
+/**
+ *  Bounds the quotient of two intervals, where the denominator is positive.
+ */
+static void floatQuotient(double nlo, double nhi, double dlo, double dhi,
+        double* lo, double* hi)
+{
+    double q[4];
+    int i;
+
+    q[0] = nlo / dlo;
+    q[1] = nlo / dhi;
+    q[2] = nhi / dlo;
+    q[3] = nhi / dhi;
+    *lo = *hi = q[0];
+    for (i = 1; i < 4; ++i)
+    {
+        *lo = q[i] < *lo ? q[i] : *lo;
+        *hi = q[i] > *hi ? q[i] : *hi;
+    }
+    *lo = DOWN(*lo);
+    *hi = UP(*hi);
+}
+
+/**
+ *  Combines a "lesser-than" row with a "greater-than" row on column
+ *  {@code k} by scaling each with the magnitude of the other's pivot.
+ *  <p>
+ *  The radius of each entry covers the radii of the operands as well as the
+ *  rounding of the midpoint computation, and is itself rounded upwards by a
+ *  generous factor.
+ */
+static void floatCombine(double* v, double* r, float_row_t* row,
+        const double* pv, const double* pr, const float_row_t* prow,
+        const double* nv, const double* nr, const float_row_t* nrow,
+        int k, int W)
+{
+    double a = -nv[k];
+    double ra = nr[k];
+    double c = pv[k];
+    double rc = pr[k];
+    double max = 0;
+    double m;
+    int e;
+    int j;
+
+    if (prow->exact && nrow->exact
+            && a * prow->max + c * nrow->max < FLOAT_EXACT)
+    {
+        for (j = 0; j < W; ++j)
+        {
+            v[j] = a * pv[j] + c * nv[j];
+            r[j] = 0;
+            m = fabs(v[j]);
+            max = m > max ? m : max;
+        }
+        row->exact = 1;
+    } else {
+        for (j = 0; j < W; ++j)
+        {
+            v[j] = a * pv[j] + c * nv[j];
+            r[j] = a * pr[j] + (fabs(pv[j]) + pr[j]) * ra
+                + c * nr[j] + (fabs(nv[j]) + nr[j]) * rc
+                + FLOAT_GAMMA2 * (a * fabs(pv[j]) + c * fabs(nv[j]));
+            if (r[j] != 0)
+            {
+                r[j] = r[j] * (1 + 16 * FLOAT_U) + 16 * DBL_MIN;
+            }
+            m = fabs(v[j]);
+            max = m > max ? m : max;
+        }
+        row->exact = 0;
+    }
+    v[k] = r[k] = 0;
+
+    if (max > FLOAT_RESCALE)
+    {
+        frexp(max, &e);
+        for (j = 0; j < W; ++j)
+        {
+            v[j] = ldexp(v[j], -e);
+            r[j] = ldexp(r[j], -e);
+        }
+        max = ldexp(max, -e);
+        row->exact = 0;
+    }
+    row->max = max;
+}
+
+/**
+ *  Swaps two rows entry by entry, with their radii and bookkeeping.
+ */
+static void floatSwap(double* v, double* r, float_row_t* rows, size_t a,
+        size_t b, int W)
+{
+    float_row_t row;
+    double t;
+    int j;
+
+    for (j = 0; j < W; ++j)
+    {
+        t = v[a * W + j];
+        v[a * W + j] = v[b * W + j];
+        v[b * W + j] = t;
+        t = r[a * W + j];
+        r[a * W + j] = r[b * W + j];
+        r[b * W + j] = t;
+    }
+    row = rows[a];
+    rows[a] = rows[b];
+    rows[b] = row;
+}
+
+/**
+ *  Moves the rows with a negative coefficient in column {@code k} to the
+ *  front, followed by those with a positive one and then the rest.
+ *
+ *  @return
+ *          Non-zero if the sign of some coefficient can not be told.
+ */
+static int floatPartition(double* v, double* r, float_row_t* rows, size_t n,
+        int k, int W, size_t* nNeg, size_t* nPos)
+{
+    size_t lo = 0;
+    size_t hi = n;
+    size_t i;
+
+    for (i = 0; i < hi; )
+    {
+        switch (floatSign(v[i * W + k], r[i * W + k]))
+        {
+        case -1:
+            if (i != lo)
+            {
+                floatSwap(v, r, rows, i, lo, W);
+            }
+            ++lo;
+            ++i;
+            break;
+        case 1:
+            ++i;
+            break;
+        case 0:
+            floatSwap(v, r, rows, i, --hi, W);
+            break;
+        default:
+            return 1;
+        }
+    }
+    *nNeg = lo;
+    *nPos = hi - lo;
+    return 0;
+}
+
+/**
+ *  Decides a system once only the first variable is left, returning
+ *  {@code ZMK_UNKNOWN} unless the answer is the same for every value within
+ *  the radii.
+ */
+static INT_T floatCheck(const double* v, const double* r, size_t n, int N,
+        int W)
+{
+    double loLo = -HUGE_VAL;
+    double loHi = -HUGE_VAL;
+    double upLo = HUGE_VAL;
+    double upHi = HUGE_VAL;
+    double qlo;
+    double qhi;
+    const double* rv;
+    const double* rr;
+    INT_T res = ZMK_SAT;
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        rv = v + i * W;
+        rr = r + i * W;
+        switch (floatSign(rv[0], rr[0]))
+        {
+        case -1:
+            /* x >= c / -a */
+            floatQuotient(DOWN(rv[N] - rr[N]), UP(rv[N] + rr[N]),
+                DOWN(-rv[0] - rr[0]), UP(-rv[0] + rr[0]), &qlo, &qhi);
+            loLo = qlo > loLo ? qlo : loLo;
+            loHi = qhi > loHi ? qhi : loHi;
+            break;
+        case 1:
+            /* x <= -c / a */
+            floatQuotient(DOWN(-rv[N] - rr[N]), UP(-rv[N] + rr[N]),
+                DOWN(rv[0] - rr[0]), UP(rv[0] + rr[0]), &qlo, &qhi);
+            upLo = qlo < upLo ? qlo : upLo;
+            upHi = qhi < upHi ? qhi : upHi;
+            break;
+        case 0:
+            switch (floatSign(rv[N], rr[N]))
+            {
+            case 1:
+                return ZMK_UNSAT;
+            case 2:
+                res = ZMK_UNKNOWN;
+                break;
+            }
+            break;
+        default:
+            res = ZMK_UNKNOWN;
+        }
+    }
+
+    if (loLo > upHi)
+        return ZMK_UNSAT;
+    else if (loHi <= upLo)
+        return res;
+    else
+        return ZMK_UNKNOWN;
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Performs Fourier-Motzkin elimination in double precision, deciding the
+ *  system only if the answer is certain.
+ *  <p>
+ *  Each row is scaled to integers by {@code integerEquation}. A level
+ *  at which the sign of some pivot can not be told, like the last one
+ *  leaving bounds that may or may not cross, ends the elimination with
+ *  {@code ZMK_UNKNOWN}, to be settled by an exact engine. The rows of each
+ *  level are partitioned in place by the sign of the pivot and paired tile
+ *  by tile. The system itself is left untouched.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param budget
+ *          The budget of the solve, may be NULL.
+ *  @return
+ *          {@code ZMK_SAT}, {@code ZMK_UNSAT}, {@code ZMK_UNKNOWN} or
+ *          {@code ZMK_BUDGET}.
+ */
+INT_T zmkFloat(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, zmk_budget_t* budget)
+{
+    int W = nVar + 1;
+    size_t n = nEqn;
+    double* v = (double*) malloc(sizeof(double) * W * (n + 1));
+    double* r = (double*) calloc(W * (n + 1), sizeof(double));
+    float_row_t* rows = (float_row_t*) malloc(sizeof(float_row_t) * (n + 1));
+    double* nextV;
+    double* nextR;
+    float_row_t* nextRows;
+    long long* scaled = (long long*) malloc(sizeof(long long) * W);
+    double m;
+    size_t nNeg;
+    size_t nPos;
+    size_t nZero;
+    size_t nNext;
+    size_t tile = TILE_ROWS(2 * sizeof(double) * W + sizeof(float_row_t));
+    size_t ti;
+    size_t tj;
+    size_t iEnd;
+    size_t jEnd;
+    size_t p;
+    size_t i;
+    size_t j;
+    INT_T res = ZMK_UNKNOWN;
+    int stop = 0;
+    int k;
+
+    if (scaled == NULL || v == NULL || r == NULL || rows == NULL)
+    {
+        free(scaled);
+        free(v);
+        free(r);
+        free(rows);
+        return ZMK_UNKNOWN;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        if (!integerEquation(eqns[i], nVar, scaled))
+        {
+            free(scaled);
+            free(v);
+            free(r);
+            free(rows);
+            return ZMK_UNKNOWN;
+        }
+
+        /* Conversions of integers beyond 2^53 round, and get a radius. */
+        rows[i].max = 0;
+        for (j = 0; j < (size_t) W; ++j)
+        {
+            v[i * W + j] = (double) scaled[j];
+            m = fabs(v[i * W + j]);
+            rows[i].max = m > rows[i].max ? m : rows[i].max;
+        }
+        rows[i].exact = rows[i].max < FLOAT_EXACT;
+        for (j = 0; !rows[i].exact && j < (size_t) W; ++j)
+        {
+            r[i * W + j] = UP(fabs(v[i * W + j]) * FLOAT_U);
+        }
+    }
+
+    free(scaled);
+
+    for (k = nVar - 1; k > 0 && n; --k)
+    {
+        if (floatPartition(v, r, rows, n, k, W, &nNeg, &nPos))
+        {
+            break;
+        }
+
+        /* Only rows without x_k are kept if it is bounded from one side. */
+        nZero = n - nNeg - nPos;
+        nNext = nZero;
+        if (nNeg && nPos)
+        {
+            if (nPos > ((size_t) -1 / sizeof(double) / W - nNext) / nNeg)
+            {
+                break;
+            }
+            nNext += nNeg * nPos;
+        }
+        if (budgetLevel(budget, nNeg * nPos, (2 * sizeof(double) * W
+                + sizeof(float_row_t)) * nNext))
+        {
+            res = ZMK_BUDGET;
+            break;
+        }
+
+        nextV = (double*) malloc(sizeof(double) * W * (nNext + 1));
+        nextR = (double*) malloc(sizeof(double) * W * (nNext + 1));
+        nextRows = (float_row_t*) malloc(sizeof(float_row_t) * (nNext + 1));
+        if (nextV == NULL || nextR == NULL || nextRows == NULL)
+        {
+            free(nextV);
+            free(nextR);
+            free(nextRows);
+            break;
+        }
+
+        p = nNeg + nPos;
+        memcpy(nextV, v + p * W, sizeof(double) * W * nZero);
+        memcpy(nextR, r + p * W, sizeof(double) * W * nZero);
+        memcpy(nextRows, rows + p, sizeof(float_row_t) * nZero);
+        p = nZero;
+        for (ti = 0; nNeg && ti < nPos && !stop; ti += tile)
+        {
+            iEnd = ti + tile < nPos ? ti + tile : nPos;
+            for (tj = 0; tj < nNeg && !stop; tj += tile)
+            {
+                stop = budgetCheck(budget);
+                jEnd = tj + tile < nNeg ? tj + tile : nNeg;
+                for (i = nNeg + ti; i < nNeg + iEnd && !stop; ++i)
+                {
+                    for (j = tj; j < jEnd; ++j, ++p)
+                    {
+                        floatCombine(nextV + p * W, nextR + p * W,
+                            nextRows + p, v + i * W, r + i * W, rows + i,
+                            v + j * W, r + j * W, rows + j, k, W);
+                    }
+                }
+            }
+        }
+
+        if (stop)
+        {
+            free(nextV);
+            free(nextR);
+            free(nextRows);
+            res = ZMK_BUDGET;
+            break;
+        }
+
+        free(v);
+        free(r);
+        free(rows);
+        v = nextV;
+        r = nextR;
+        rows = nextRows;
+        n = nNext;
+    }
+
+    if (res != ZMK_BUDGET && (k == 0 || !n))
+    {
+        res = floatCheck(v, r, n, nVar, W);
+    }
+
+    free(v);
+    free(r);
+    free(rows);
+    return res;
+}
+
+#endif
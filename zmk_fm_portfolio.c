@@ -0,0 +1,309 @@
+#ifndef ZMK_FM_PORTFOLIO_C
+#define ZMK_FM_PORTFOLIO_C
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "coeff.h"
+#include "util.h"
+#include "zmk.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ *  The ways zmkPortfolio tries a system. Each works on its own copy, with
+ *  or without presolve, with the columns in the order read or reversed,
+ *  which reverses the order the engines eliminate in, and with the engine
+ *  given. Engines marked PORTFOLIO_KEEPS leave the system to be freed.
+ *  The full cascade comes first, so that one thread alone behaves like
+ *  zmkSolveEq.
+ *  <p>
+ *  No answer is taken on trust. The float configurations only answer when
+ *  the error bounds leave no doubt, and sparse when its 64-bit arithmetic
+ *  did not overflow. The cascade, reversed and unpresolved end in zmkFast,
+ *  whose answer only stands when its coefficients did not overflow and
+ *  which returns ZMK_UNKNOWN otherwise, so that they do not win.
+ */
+#define PORTFOLIO_PRESOLVE  (1)
+#define PORTFOLIO_REVERSE   (2)
+#define PORTFOLIO_KEEPS     (4)
+
+static const struct portfolio_config {
+    const char* name;
+    int flags;
+    INT_T (*solve)(EQN_T***, ROW_T, INT_T, zmk_budget_t*);
+} portfolioConfigs[] = {
+    { "cascade", PORTFOLIO_PRESOLVE, zmkComponents },
+    { "reversed", PORTFOLIO_PRESOLVE | PORTFOLIO_REVERSE, zmkComponents },
+    { "float", PORTFOLIO_PRESOLVE | PORTFOLIO_KEEPS, zmkFloat },
+    { "float-reversed", PORTFOLIO_PRESOLVE | PORTFOLIO_REVERSE
+        | PORTFOLIO_KEEPS, zmkFloat },
+    { "unpresolved", 0, zmkEliminate },
+    { "sparse", PORTFOLIO_PRESOLVE | PORTFOLIO_KEEPS, zmkSparse },
+};
+
+#define PORTFOLIO_SIZE  \
+    ((int) (sizeof portfolioConfigs / sizeof portfolioConfigs[0]))
+
+/*
+ *  What the threads of one portfolio share. The system is only read, each
+ *  configuration solves a copy of it.
+ */
+typedef struct portfolio {
+    EQN_T*** eqns;
+    ROW_T nEqn;
+    INT_T nVar;
+    ROW_T nEq;
+    int nConfigs;
+    int next;               /* The next configuration to start. */
+    int winner;             /* The first to decide the system, or -1. */
+    int nBudget;            /* Configurations that ran out of budget. */
+    INT_T res;
+    zmk_budget_t budgets[PORTFOLIO_SIZE];
+    pthread_mutex_t lock;
+} portfolio_t;
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Copies a system for a configuration, reversing its columns if asked and
+ *  turning its equalities into two opposite rows if it skips presolve.
+ *
+ *  @return
+ *          The copy, with {@code *nEqn} set to its number of rows.
+ */
+static EQN_T*** portfolioCopy(portfolio_t* pool, int flags, ROW_T* nEqn)
+{
+    INT_T nVar = pool->nVar;
+    ROW_T n = pool->nEqn;
+    ROW_T i;
+    INT_T j;
+    EQN_T*** eqns;
+    EQN_T* t;
+
+    if (!(flags & PORTFOLIO_PRESOLVE))
+    {
+        n += pool->nEq;
+    }
+    eqns = (EQN_T***) malloc(sizeof(EQN_T**) * (n + 1));
+    for (i = 0; i < pool->nEqn; ++i)
+    {
+        eqns[i] = (EQN_T**) malloc(sizeof(EQN_T*) * (nVar + 1));
+        for (j = 0; j <= nVar; ++j)
+        {
+            eqns[i][j] = copyCoeff(pool->eqns[i][j]);
+        }
+    }
+    for (; i < n; ++i)
+    {
+        eqns[i] = (EQN_T**) malloc(sizeof(EQN_T*) * (nVar + 1));
+        for (j = 0; j <= nVar; ++j)
+        {
+            eqns[i][j] = newCoeff(-pool->eqns[i - pool->nEqn][j]->nom, 1);
+        }
+    }
+
+    for (i = 0; (flags & PORTFOLIO_REVERSE) && i < n; ++i)
+    {
+        for (j = 0; j < nVar / 2; ++j)
+        {
+            t = eqns[i][j];
+            eqns[i][j] = eqns[i][nVar - 1 - j];
+            eqns[i][nVar - 1 - j] = t;
+        }
+    }
+    *nEqn = n;
+    return eqns;
+}
+
+/**
+ *  Decides a copy of the system the way one configuration does.
+ *
+ *  @return
+ *          {@code ZMK_SAT}, {@code ZMK_UNSAT}, {@code ZMK_UNKNOWN} if the
+ *          configuration could not tell or {@code ZMK_BUDGET}.
+ */
+static INT_T portfolioRun(portfolio_t* pool, int k)
+{
+    const struct portfolio_config* config = portfolioConfigs + k;
+    INT_T nVar = pool->nVar;
+    ROW_T nEqn;
+    EQN_T*** eqns = portfolioCopy(pool, config->flags, &nEqn);
+    INT_T res = ZMK_UNKNOWN;
+
+    if (config->flags & PORTFOLIO_PRESOLVE)
+    {
+        res = presolveSystem(&eqns, &nEqn, &nVar, pool->nEq, NULL, NULL,
+            NULL);
+    }
+    if (res != ZMK_UNKNOWN || budgetCheck(pool->budgets + k))
+    {
+        freeSystem(eqns, nEqn, nVar + 1);
+        return res != ZMK_UNKNOWN ? res : ZMK_BUDGET;
+    }
+
+    res = config->solve(eqns, nEqn, nVar, pool->budgets + k);
+    if (config->flags & PORTFOLIO_KEEPS)
+    {
+        freeSystem(eqns, nEqn, nVar + 1);
+    }
+    return res > 0 ? ZMK_SAT : res;
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Runs configurations until none is left or one has decided the system,
+ *  in which case it cancels the budgets of all others.
+ */
+static void* portfolioWork(void* arg)
+{
+    portfolio_t* pool = (portfolio_t*) arg;
+    INT_T res;
+    int expected;
+    int k;
+    int i;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        k = pool->next < pool->nConfigs
+            && __atomic_load_n(&pool->winner, __ATOMIC_ACQUIRE) < 0
+            ? pool->next++ : -1;
+        pthread_mutex_unlock(&pool->lock);
+        if (k < 0)
+        {
+            break;
+        }
+
+        res = portfolioRun(pool, k);
+        if (res == ZMK_BUDGET)
+        {
+            __atomic_add_fetch(&pool->nBudget, 1, __ATOMIC_RELAXED);
+        }
+        expected = -1;
+        if ((res == ZMK_SAT || res == ZMK_UNSAT)
+                && __atomic_compare_exchange_n(&pool->winner, &expected, k,
+                    0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            pool->res = res;
+            for (i = 0; i < pool->nConfigs; ++i)
+            {
+                if (i != k)
+                {
+                    budgetCancel(pool->budgets + i);
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ *  Decides a system as read by {@code parseSystemEq} by racing several
+ *  configurations of the solver against each other, one per thread. They
+ *  differ in presolve, the order of elimination and the engine, and no one
+ *  of them is fastest on every system. The first configuration to decide
+ *  the system publishes its answer and cancels the budgets of the others,
+ *  which stop at their next check.
+ *  <p>
+ *  Each configuration solves its own copy within a child of the budget
+ *  passed in. The system is freed in all cases.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param nEq
+ *          The number of equalities at the front of the system.
+ *  @param nThreads
+ *          The number of configurations to run at once, or zero for one per
+ *          online processor.
+ *  @param budget
+ *          The budget of the solve, may be NULL.
+ *  @param winner
+ *          Set to the name of the configuration that decided the system, or
+ *          NULL if none did, may be NULL.
+ *  @return
+ *          {@code ZMK_SAT} or {@code ZMK_UNSAT}. If no configuration
+ *          decided the system, {@code ZMK_BUDGET} if one of them ran out of
+ *          its budget and {@code ZMK_UNKNOWN} if they all ran to the end,
+ *          as the cascade does when its coefficients overflow.
+ */
+INT_T zmkPortfolio(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, ROW_T nEq,
+        int nThreads, zmk_budget_t* budget, const char** winner)
+{
+    portfolio_t pool;
+    pthread_t threads[PORTFOLIO_SIZE];
+    size_t rows = 0;
+    int nStarted = 0;
+    int k;
+
+    if (nThreads < 1)
+    {
+        nThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+        nThreads = nThreads < 1 ? 1 : nThreads;
+    }
+
+    pool.eqns = eqns;
+    pool.nEqn = nEqn;
+    pool.nVar = nVar;
+    pool.nEq = nEq;
+    pool.nConfigs = PORTFOLIO_SIZE;
+    pool.next = 0;
+    pool.winner = -1;
+    pool.nBudget = 0;
+    pool.res = ZMK_BUDGET;
+    for (k = 0; k < pool.nConfigs; ++k)
+    {
+        if (budget != NULL)
+            pool.budgets[k] = *budget;
+        else
+            budgetStart(pool.budgets + k, 0, 0, 0);
+        pool.budgets[k].parent = budget;
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+
+    nThreads = nThreads < pool.nConfigs ? nThreads : pool.nConfigs;
+    while (nStarted < nThreads - 1 && !pthread_create(threads + nStarted,
+            NULL, portfolioWork, &pool))
+    {
+        ++nStarted;
+    }
+    portfolioWork(&pool);
+    for (k = 0; k < nStarted; ++k)
+    {
+        pthread_join(threads[k], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+    if (pool.winner < 0 && !pool.nBudget)
+    {
+        pool.res = ZMK_UNKNOWN;
+    }
+
+    if (budget != NULL)
+    {
+        for (k = 0; k < pool.nConfigs; ++k)
+        {
+            rows += pool.budgets[k].nRows - budget->nRows;
+            budget->nBytes = pool.budgets[k].nBytes > budget->nBytes
+                ? pool.budgets[k].nBytes : budget->nBytes;
+        }
+        budget->nRows += rows;
+    }
+    if (winner != NULL)
+    {
+        *winner = pool.winner < 0 ? NULL : portfolioConfigs[pool.winner].name;
+    }
+    freeSystem(eqns, nEqn, nVar + 1);
+    return pool.res;
+}
+
+#endif
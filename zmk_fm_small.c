@@ -1,19 +1,284 @@
 #ifndef ZMK_FM_SMALL_C
 #define ZMK_FM_SMALL_C
 
+#include "coeff.h"
 #include "util.h"
+#include "zmk.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <limits.h>
+#include <string.h>
 
-INT_T zmkSmall(EQN_T** eqns, INT_T len, INT_T nVar) {
-    if (0)
+/*
+ *  All rows of zmkSmall live in one static buffer of SMALL_BYTES bytes,
+ *  which is all the memory the elimination ever uses. A row of width w
+ *  holds its constant first and then the coefficients of x_0 .. x_{w-2},
+ *  so the variable eliminated next is always the last entry and dropping
+ *  it only narrows the rows.
+ */
+#define SMALL_T         long long
+
+static SMALL_T smallBuffer[SMALL_BYTES / sizeof(SMALL_T)];
+
+#define SMALL_CAP       (sizeof smallBuffer / sizeof smallBuffer[0])
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Swaps two rows entry by entry, so that no temporary row is needed.
+ */
+static void smallSwap(SMALL_T* a, SMALL_T* b, int w)
+{
+    SMALL_T t;
+    int j;
+
+    for (j = 0; j < w; ++j)
+    {
+        t = a[j];
+        a[j] = b[j];
+        b[j] = t;
+    }
+}
+
+/**
+ *  Orders the rows as those without the last variable, those with a
+ *  negative coefficient for it and those with a positive one.
+ */
+static void smallPartition(SMALL_T* rows, size_t n, int w, size_t* nZero,
+        size_t* nNeg)
+{
+    size_t zero = 0;
+    size_t neg;
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        if (!rows[i * w + w - 1])
+        {
+            smallSwap(rows + i * w, rows + zero++ * w, w);
+        }
+    }
+    for (i = neg = zero; i < n; ++i)
+    {
+        if (rows[i * w + w - 1] < 0)
+        {
+            smallSwap(rows + i * w, rows + neg++ * w, w);
+        }
+    }
+    *nZero = zero;
+    *nNeg = neg - zero;
+}
+
+/**
+ *  Writes the combination of a row with a positive and a row with a negative
+ *  last coefficient, without that coefficient and divided by the gcd of its
+ *  entries.
+ *
+ *  @return
+ *          Non-zero if a value overflowed.
+ */
+static int smallCombine(SMALL_T* out, const SMALL_T* pos, const SMALL_T* neg,
+        int w)
+{
+    SMALL_T a = -neg[w - 1];
+    SMALL_T c = pos[w - 1];
+    SMALL_T x;
+    SMALL_T y;
+    SMALL_T g = 0;
+    int overflow = 0;
+    int j;
+
+    for (j = 0; j < w - 1; ++j)
+    {
+        overflow |= __builtin_mul_overflow(pos[j], a, &x);
+        overflow |= __builtin_mul_overflow(neg[j], c, &y);
+        overflow |= __builtin_add_overflow(x, y, &out[j]);
+        g = gcdLong(g, out[j]);
+    }
+    for (j = 0; g > 1 && j < w - 1; ++j)
+    {
+        out[j] /= g;
+    }
+    return overflow;
+}
+
+/**
+ *  Decides rows of width two, {@code c + a x <= 0}, or width one,
+ *  {@code c <= 0}.
+ */
+static INT_T smallCheck(const SMALL_T* rows, size_t n, int w)
+{
+    SMALL_T loNom = 0;
+    SMALL_T loDen = 0;
+    SMALL_T upNom = 0;
+    SMALL_T upDen = 0;
+    SMALL_T x = 0;
+    SMALL_T y = 0;
+    SMALL_T a;
+    SMALL_T c;
+    int overflow = 0;
+    size_t i;
+
+    for (i = 0; i < n; ++i)
+    {
+        c = rows[i * w];
+        a = w > 1 ? rows[i * w + 1] : 0;
+        if (a < 0)
+        {
+            overflow |= __builtin_mul_overflow(c, loDen, &x);
+            overflow |= __builtin_mul_overflow(loNom, -a, &y);
+            if (!loDen || x > y)
+            {
+                loNom = c;
+                loDen = -a;
+            }
+        } else if (a > 0) {
+            overflow |= __builtin_mul_overflow(-c, upDen, &x);
+            overflow |= __builtin_mul_overflow(upNom, a, &y);
+            if (!upDen || x < y)
+            {
+                upNom = -c;
+                upDen = a;
+            }
+        } else if (c > 0) {
+            return ZMK_UNSAT;
+        }
+    }
+
+    if (loDen && upDen)
+    {
+        overflow |= __builtin_mul_overflow(loNom, upDen, &x);
+        overflow |= __builtin_mul_overflow(upNom, loDen, &y);
+    }
+    if (overflow)
+        return ZMK_UNKNOWN;
+    else if (loDen && upDen && x > y)
+        return ZMK_UNSAT;
+    else
+        return ZMK_SAT;
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Performs Fourier-Motzkin elimination in place inside a fixed buffer.
+ *  <p>
+ *  At each level the rows are partitioned in place and the combinations of
+ *  the rows with a positive and a negative last coefficient are written
+ *  after them. The rows without that variable and the combinations are then
+ *  moved down to the start of the buffer at the narrower width, so nothing
+ *  is allocated and the buffer never holds more than one level and the next.
+ *  The system itself is left untouched.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param peak
+ *          Set to the largest number of bytes of the buffer in use, may be
+ *          NULL.
+ *  @return
+ *          {@code ZMK_SAT}, {@code ZMK_UNSAT}, {@code ZMK_UNKNOWN} if a
+ *          value overflowed or {@code ZMK_BUDGET} if the rows did not fit
+ *          the buffer.
+ */
+INT_T zmkSmall(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, size_t* peak)
+{
+    SMALL_T* rows = smallBuffer;
+    SMALL_T* out;
+    SMALL_T c;
+    size_t n = nEqn;
+    size_t nZero;
+    size_t nNeg;
+    size_t nPos;
+    size_t need;
+    size_t most;
+    size_t i;
+    size_t j;
+    int overflow = 0;
+    int w = nVar + 1;
+    INT_T res = ZMK_UNKNOWN;
+
+    most = n * w;
+    if (peak != NULL)
+    {
+        *peak = 0;
+    }
+    if (n > SMALL_CAP / w || most > SMALL_CAP)
+    {
+        return ZMK_BUDGET;
+    }
+
+    /* Rows are scaled in place and their constant moved to the front. */
+    for (i = 0; i < n; ++i)
+    {
+        out = rows + i * w;
+        if (!integerEquation(eqns[i], nVar, out))
+        {
+            return ZMK_UNKNOWN;
+        }
+        c = out[nVar];
+        memmove(out + 1, out, sizeof(SMALL_T) * nVar);
+        out[0] = c;
+    }
+
+    while (w > 2 && n && !overflow)
+    {
+        smallPartition(rows, n, w, &nZero, &nNeg);
+        nPos = n - nZero - nNeg;
+        if (!nNeg || !nPos)
+        {
+            nPos = nNeg = 0;
+        }
+
+        /* Both levels have to fit while the next one is written. */
+        if (__builtin_mul_overflow(nNeg, nPos, &need)
+                || __builtin_mul_overflow(need, w - 1, &need)
+                || __builtin_add_overflow(need, n * w, &need)
+                || need > SMALL_CAP)
+        {
+            res = ZMK_BUDGET;
+            break;
+        }
+        most = need > most ? need : most;
+
+        out = rows + n * w;
+        for (i = 0; i < nPos; ++i)
+        {
+            for (j = 0; j < nNeg; ++j)
+            {
+                overflow |= smallCombine(out,
+                    rows + (nZero + nNeg + i) * w,
+                    rows + (nZero + j) * w, w);
+                out += w - 1;
+            }
+        }
+
+        for (i = 0; i < nZero; ++i)
+        {
+            memmove(rows + i * (w - 1), rows + i * w,
+                sizeof(SMALL_T) * (w - 1));
+        }
+        memmove(rows + nZero * (w - 1), rows + n * w,
+            sizeof(SMALL_T) * nNeg * nPos * (w - 1));
+        n = nZero + nNeg * nPos;
+        --w;
+    }
+
+    if (!overflow && res != ZMK_BUDGET)
+    {
+        res = smallCheck(rows, n, w);
+    }
+    if (peak != NULL)
     {
-        len = len;
-        eqns = eqns;
-        nVar = nVar;
+        *peak = most * sizeof(SMALL_T);
     }
-    return 0;
+    return res;
 }
 
 #endif
@@ -0,0 +1,430 @@
+#ifndef ZMK_FM_SPARSE_C
+#define ZMK_FM_SPARSE_C
+
+#include "coeff.h"
+#include "util.h"
+#include "zmk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ *  A level of the sparse engine keeps its rows back to back: row i has the
+ *  columns col[start[i]] .. col[start[i + 1] - 1] in increasing order, their
+ *  non-zero values in val and its constant in cst. Variables are eliminated
+ *  from the last column down, so the pivot of a row that has one is always
+ *  its last entry.
+ */
+typedef struct sparse_sys {
+    size_t n;
+    size_t* start;
+    int* col;
+    long long* val;
+    long long* cst;
+} sparse_sys_t;
+
+/* ========== *
+ *  Utility.  *
+ * ========== */
+
+/**
+ *  Allocates memory for a level of {@code n} rows and {@code nnz} entries.
+ *
+ *  @return
+ *          Zero if memory ran out, non-zero otherwise.
+ */
+static int sparseAlloc(sparse_sys_t* s, size_t n, size_t nnz)
+{
+    s->n = 0;
+    s->start = (size_t*) malloc(sizeof(size_t) * (n + 1));
+    s->col = (int*) malloc(sizeof(int) * (nnz + 1));
+    s->val = (long long*) malloc(sizeof(long long) * (nnz + 1));
+    s->cst = (long long*) malloc(sizeof(long long) * (n + 1));
+    if (s->start == NULL || s->col == NULL || s->val == NULL || s->cst == NULL)
+    {
+        return 0;
+    }
+    s->start[0] = 0;
+    return 1;
+}
+
+/**
+ *  Frees the memory of a level.
+ */
+static void sparseFree(sparse_sys_t* s)
+{
+    free(s->start);
+    free(s->col);
+    free(s->val);
+    free(s->cst);
+}
+
+/**
+ *  Returns the sign of the coefficient of column {@code k} in a row.
+ */
+static int sparsePivot(const sparse_sys_t* s, size_t i, int k)
+{
+    size_t last = s->start[i + 1];
+    if (last == s->start[i] || s->col[last - 1] != k)
+    {
+        return 0;
+    }
+    return s->val[last - 1] < 0 ? -1 : 1;
+}
+
+/**
+ *  Appends a copy of a row of another level.
+ */
+static void sparseCopy(sparse_sys_t* to, const sparse_sys_t* from, size_t i)
+{
+    size_t len = from->start[i + 1] - from->start[i];
+    size_t at = to->start[to->n];
+
+    memcpy(to->col + at, from->col + from->start[i], sizeof(int) * len);
+    memcpy(to->val + at, from->val + from->start[i], sizeof(long long) * len);
+    to->cst[to->n] = from->cst[i];
+    to->start[++to->n] = at + len;
+}
+
+/**
+ *  Appends the combination of a "lesser-than" row {@code p} and a
+ *  "greater-than" row {@code q}, both ending in the pivot column.
+ *  <p>
+ *  The two rows are merged by column, each scaled by the magnitude of the
+ *  other's pivot, so the pivot cancels and is left out. Entries that cancel
+ *  are left out as well and the result is divided by the gcd of its entries.
+ *
+ *  @return
+ *          Non-zero if a value overflowed.
+ */
+static int sparseCombine(sparse_sys_t* to, const sparse_sys_t* from,
+        size_t p, size_t q)
+{
+    size_t i = from->start[p];
+    size_t ie = from->start[p + 1] - 1;
+    size_t j = from->start[q];
+    size_t je = from->start[q + 1] - 1;
+    long long a = -from->val[je];
+    long long c = from->val[ie];
+    long long x;
+    long long y;
+    long long g;
+    size_t at = to->start[to->n];
+    size_t m = at;
+    int overflow = 0;
+
+    overflow |= __builtin_mul_overflow(from->cst[p], a, &x);
+    overflow |= __builtin_mul_overflow(from->cst[q], c, &y);
+    overflow |= __builtin_add_overflow(x, y, &x);
+    to->cst[to->n] = x;
+    g = x;
+
+    while (i < ie || j < je)
+    {
+        if (j == je || (i < ie && from->col[i] < from->col[j]))
+        {
+            to->col[m] = from->col[i];
+            overflow |= __builtin_mul_overflow(from->val[i++], a, &x);
+        } else if (i == ie || from->col[j] < from->col[i]) {
+            to->col[m] = from->col[j];
+            overflow |= __builtin_mul_overflow(from->val[j++], c, &x);
+        } else {
+            to->col[m] = from->col[i];
+            overflow |= __builtin_mul_overflow(from->val[i++], a, &x);
+            overflow |= __builtin_mul_overflow(from->val[j++], c, &y);
+            overflow |= __builtin_add_overflow(x, y, &x);
+        }
+        if (x)
+        {
+            to->val[m++] = x;
+            g = gcdLong(g, x);
+        }
+    }
+
+    if (g > 1)
+    {
+        to->cst[to->n] /= g;
+        for (i = at; i < m; ++i)
+        {
+            to->val[i] /= g;
+        }
+    }
+    to->start[++to->n] = m;
+    return overflow;
+}
+
+/**
+ *  Decides a level in which only the first variable is left. Each row is
+ *  either empty and reads {@code c <= 0} or reads {@code a x + c <= 0}.
+ */
+static INT_T sparseCheck(const sparse_sys_t* s)
+{
+    long long loNom = 0;
+    long long loDen = 0;
+    long long upNom = 0;
+    long long upDen = 0;
+    long long x;
+    long long y;
+    long long a;
+    long long c;
+    int overflow = 0;
+    size_t i;
+
+    for (i = 0; i < s->n; ++i)
+    {
+        c = s->cst[i];
+        if (s->start[i] == s->start[i + 1])
+        {
+            if (c > 0)
+            {
+                return ZMK_UNSAT;
+            }
+            continue;
+        }
+
+        a = s->val[s->start[i]];
+        if (a < 0)
+        {
+            /* x >= c / -a */
+            overflow |= __builtin_mul_overflow(c, loDen, &x);
+            overflow |= __builtin_mul_overflow(loNom, -a, &y);
+            if (!loDen || x > y)
+            {
+                loNom = c;
+                loDen = -a;
+            }
+        } else {
+            /* x <= -c / a */
+            overflow |= __builtin_mul_overflow(-c, upDen, &x);
+            overflow |= __builtin_mul_overflow(upNom, a, &y);
+            if (!upDen || x < y)
+            {
+                upNom = -c;
+                upDen = a;
+            }
+        }
+    }
+
+    if (!loDen || !upDen)
+    {
+        return overflow ? ZMK_UNKNOWN : ZMK_SAT;
+    }
+    overflow |= __builtin_mul_overflow(loNom, upDen, &x);
+    overflow |= __builtin_mul_overflow(upNom, loDen, &y);
+    if (overflow)
+    {
+        return ZMK_UNKNOWN;
+    }
+    return x <= y ? ZMK_SAT : ZMK_UNSAT;
+}
+
+/* ============ *
+ *  Algorithm.  *
+ * ============ */
+
+/**
+ *  Returns the fraction of the coefficients of a system that are non-zero,
+ *  used to choose between the sparse and the dense engines.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @return
+ *          The density of the system, between zero and one.
+ */
+float systemDensity(EQN_T*** eqns, ROW_T nEqn, INT_T nVar)
+{
+    size_t nnz = 0;
+    ROW_T i;
+    INT_T j;
+
+    if (!nEqn || !nVar)
+    {
+        return 0;
+    }
+    for (i = 0; i < nEqn; ++i)
+    {
+        for (j = 0; j < nVar; ++j)
+        {
+            nnz += eqns[i][j]->nom != 0;
+        }
+    }
+    return (float) nnz / ((float) nEqn * nVar);
+}
+
+/**
+ *  Performs Fourier-Motzkin elimination on sparse rows, so that memory and
+ *  the work of pairing two rows follow their number of non-zero entries
+ *  rather than the number of variables.
+ *  <p>
+ *  Each row is scaled to integers by {@code integerEquation}. The system
+ *  itself is left untouched.
+ *
+ *  @param eqns
+ *          The system of equations.
+ *  @param nEqn
+ *          The number of equations.
+ *  @param nVar
+ *          The number of variables in each equation.
+ *  @param budget
+ *          The budget of the solve, may be NULL.
+ *  @return
+ *          {@code ZMK_SAT}, {@code ZMK_UNSAT}, {@code ZMK_UNKNOWN} if a
+ *          value overflowed or memory ran out or {@code ZMK_BUDGET}.
+ */
+INT_T zmkSparse(EQN_T*** eqns, ROW_T nEqn, INT_T nVar, zmk_budget_t* budget)
+{
+    sparse_sys_t cur = { 0 };
+    sparse_sys_t next = { 0 };
+    long long* scaled = (long long*) malloc(sizeof(long long) * (nVar + 1));
+    size_t* negIndices;
+    size_t* posIndices;
+    size_t nNeg;
+    size_t nPos;
+    size_t nRow;
+    size_t nnz;
+    size_t nnzNeg;
+    size_t nnzPos;
+    size_t len;
+    size_t i;
+    size_t j;
+    INT_T res = ZMK_UNKNOWN;
+    int overflow = 0;
+    int stop = 0;
+    int k;
+
+    /* The first level is sized by its non-zero entries, not nEqn * nVar. */
+    for (i = 0, nnz = 0; i < nEqn; ++i)
+    {
+        for (k = 0; k < nVar; ++k)
+        {
+            nnz += eqns[i][k]->nom != 0;
+        }
+    }
+    if (scaled == NULL || !sparseAlloc(&cur, nEqn, nnz))
+    {
+        sparseFree(&cur);
+        free(scaled);
+        return ZMK_UNKNOWN;
+    }
+
+    for (i = 0; i < nEqn; ++i)
+    {
+        if (!integerEquation(eqns[i], nVar, scaled))
+        {
+            overflow = 1;
+            break;
+        }
+        len = cur.start[i];
+        for (k = 0; k < nVar; ++k)
+        {
+            if (scaled[k])
+            {
+                cur.col[len] = k;
+                cur.val[len++] = scaled[k];
+            }
+        }
+        cur.cst[i] = scaled[nVar];
+        cur.start[++cur.n] = len;
+    }
+    free(scaled);
+
+    for (k = nVar - 1; k > 0 && cur.n && !overflow && !stop; --k)
+    {
+        negIndices = (size_t*) malloc(sizeof(size_t) * cur.n);
+        posIndices = (size_t*) malloc(sizeof(size_t) * cur.n);
+        if (negIndices == NULL || posIndices == NULL)
+        {
+            free(negIndices);
+            free(posIndices);
+            overflow = 1;
+            break;
+        }
+
+        nNeg = nPos = 0;
+        nnz = nnzNeg = nnzPos = 0;
+        for (i = 0; i < cur.n; ++i)
+        {
+            len = cur.start[i + 1] - cur.start[i];
+            switch (sparsePivot(&cur, i, k))
+            {
+            case -1:
+                negIndices[nNeg++] = i;
+                nnzNeg += len - 1;
+                break;
+            case 1:
+                posIndices[nPos++] = i;
+                nnzPos += len - 1;
+                break;
+            default:
+                nnz += len;
+            }
+        }
+
+        /* Rows bounding x_k from one side only are always satisfiable. */
+        nRow = cur.n - nNeg - nPos;
+        if (nNeg && nPos)
+        {
+            overflow |= __builtin_mul_overflow(nNeg, nPos, &len);
+            overflow |= __builtin_add_overflow(nRow, len, &nRow);
+            overflow |= __builtin_mul_overflow(nNeg, nnzPos, &len);
+            overflow |= __builtin_add_overflow(nnz, len, &nnz);
+            overflow |= __builtin_mul_overflow(nPos, nnzNeg, &len);
+            overflow |= __builtin_add_overflow(nnz, len, &nnz);
+        }
+
+        if (!overflow && budgetLevel(budget, nRow - (cur.n - nNeg - nPos),
+                (sizeof(size_t) + sizeof(long long)) * nRow
+                + (sizeof(int) + sizeof(long long)) * nnz))
+        {
+            free(negIndices);
+            free(posIndices);
+            stop = 1;
+            break;
+        }
+        if (overflow || !sparseAlloc(&next, nRow, nnz))
+        {
+            sparseFree(&next);
+            free(negIndices);
+            free(posIndices);
+            overflow = 1;
+            break;
+        }
+        for (i = 0; i < cur.n; ++i)
+        {
+            if (!sparsePivot(&cur, i, k))
+            {
+                sparseCopy(&next, &cur, i);
+            }
+        }
+        for (i = 0; nNeg && i < nPos && !stop; ++i)
+        {
+            stop = budgetCheck(budget);
+            for (j = 0; j < nNeg && !stop; ++j)
+            {
+                overflow |= sparseCombine(&next, &cur, posIndices[i],
+                    negIndices[j]);
+            }
+        }
+
+        sparseFree(&cur);
+        free(negIndices);
+        free(posIndices);
+        cur = next;
+        memset(&next, 0, sizeof next);
+    }
+
+    if (stop)
+    {
+        res = ZMK_BUDGET;
+    } else if (!overflow) {
+        res = sparseCheck(&cur);
+    }
+    sparseFree(&cur);
+    return res;
+}
+
+#endif